@@ -0,0 +1,441 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include "main.hpp"
+#include "bus.hpp"
+#include "cache.hpp"
+#include "trace.hpp"
+#include "state.hpp"
+#include "simulator.hpp"
+
+using namespace std;
+
+// Simulator throughput benchmarks (make bench). Microbenchmarks drive one
+// engine path directly on a bound SimulationState across a matrix of cache
+// geometries; end-to-end runs time whole simulations of real traces. Every
+// result is the fastest of BENCH_REPEATS runs.
+
+static const int BENCH_REPEATS = 3;
+
+// Results of loops with nothing else to show are kept here so the compiler
+// cannot drop them
+static volatile unsigned long long benchSink;
+
+// Cache geometries of the microbenchmark matrix: s, E, b
+static const int benchGeometries[][3] = {
+    {6, 2, 5}, {6, 8, 5}, {6, 8, 6}, {10, 2, 5}, {10, 8, 5}, {10, 8, 6}, {14, 4, 6}, {14, 16, 6}
+};
+
+struct BenchResult
+{
+    string name;
+    string config;          // "s=6 E=2 b=5", a trace or empty
+    string mode;            // Engine of an end-to-end run
+    long long accesses;     // Simulated (or parsed) accesses per run
+    double seconds;         // Fastest run
+};
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Fresh simulation state of one geometry, bound to this thread while alive
+class BenchSimulation
+{
+public:
+    BenchSimulation(int cores, int setBits, int ways, int blockBits, bool snoopFilter)
+        : state(new SimulationState()), binding(state.get())
+    {
+        state->numCores = cores;
+        state->numSetBits = setBits;
+        state->associativity = ways;
+        state->numBlockBits = blockBits;
+        state->snoopFilterEnabled = snoopFilter;
+        initializeSimulation();
+    }
+
+private:
+    unique_ptr<SimulationState> state;
+    SimulationBinding binding;
+};
+
+static string geometryLabel(int setBits, int ways, int blockBits)
+{
+    return "s=" + to_string(setBits) + " E=" + to_string(ways) + " b=" + to_string(blockBits);
+}
+
+// Hits only: core 0 first fills its cache with modified lines, then reads
+// and writes them round-robin through executeMemoryOperation
+static double benchHitPath(int setBits, int ways, int blockBits, long long accesses)
+{
+    BenchSimulation simulation(1, setBits, ways, blockBits, false);
+    long long lineCount = (long long)ways << setBits;
+    vector<TraceRecord> lines(lineCount);
+    long long lineIdx = 0;
+    while (lineIdx < lineCount)
+    {
+        PackedTraceEntry entry = (unsigned long long)lineIdx << blockBits | TRACE_WRITE_FLAG;
+        lines[lineIdx] = decodeTraceEntry(entry);
+        executeMemoryOperation(lines[lineIdx], 0);
+        settleBusTransactions();
+        lines[lineIdx].isWrite = lineIdx & 1;
+        lineIdx++;
+    }
+
+    auto start = chrono::steady_clock::now();
+    long long accessIdx = 0;
+    lineIdx = 0;
+    while (accessIdx < accesses)
+    {
+        executeMemoryOperation(lines[lineIdx], 0);
+        lineIdx = lineIdx + 1 == lineCount ? 0 : lineIdx + 1;
+        accessIdx++;
+    }
+    double seconds = secondsSince(start);
+    if (!sim->pendingRequests.empty())
+    {
+        cerr << "Warning: hit benchmark missed in " << geometryLabel(setBits, ways, blockBits) << endl;
+    }
+    return seconds;
+}
+
+// Misses only: every call installs a new tag, so once the sets are full each
+// one evicts. Write misses leave dirty lines whose evictions queue writebacks,
+// which are dropped from the bus queue as they appear.
+static double benchMissPath(int setBits, int ways, int blockBits, bool writes, long long accesses)
+{
+    BenchSimulation simulation(1, setBits, ways, blockBits, false);
+    CacheUnit &cache = sim->processorCaches[0];
+    int setMask = (1 << setBits) - 1;
+
+    auto start = chrono::steady_clock::now();
+    long long accessIdx = 0;
+    while (accessIdx < accesses)
+    {
+        int setIndex = (int)(accessIdx & setMask);
+        unsigned long long tag = (unsigned long long)accessIdx >> setBits;
+        bool triggeredWriteback = false;
+        if (writes)
+        {
+            int way = processWriteMiss(0, setIndex, tag, triggeredWriteback);
+            cache.statesOf(setIndex)[way] = CoherenceState::MODIFIED;
+        }
+        else
+        {
+            int way = processReadMiss(0, setIndex, tag, triggeredWriteback);
+            cache.statesOf(setIndex)[way] = CoherenceState::EXCLUSIVE;
+        }
+        while (!sim->dataTransferQueue.empty())
+        {
+            sim->dataTransferQueue.pop_front();
+        }
+        cache.isStalled = false;
+        accessIdx++;
+    }
+    return secondsSince(start);
+}
+
+// Coherence traffic: four cores read and write a pool of blocks that all of
+// them share, so nearly every access goes through processBusTransactions
+// with snoops, invalidations and interventions. Bus transfers are settled
+// at once as in functional mode.
+static double benchSnoopPath(int setBits, int ways, int blockBits, bool snoopFilter, long long accesses)
+{
+    const int coreCount = 4;
+    BenchSimulation simulation(coreCount, setBits, ways, blockBits, snoopFilter);
+
+    // A pool twice the size of a cache keeps both misses and sharing frequent
+    long long poolSize = 2 * ((long long)ways << setBits);
+    vector<TraceRecord> accessPattern(1 << 16);
+    unsigned int randomState = 12345;
+    size_t patternIdx = 0;
+    while (patternIdx < accessPattern.size())
+    {
+        randomState = randomState * 1103515245 + 12345;
+        unsigned long long block = (randomState >> 8) % poolSize;
+        bool isWrite = (randomState >> 4) % 4 == 0;
+        accessPattern[patternIdx] = decodeTraceEntry(block << blockBits | (isWrite ? TRACE_WRITE_FLAG : 0));
+        patternIdx++;
+    }
+
+    auto start = chrono::steady_clock::now();
+    long long accessIdx = 0;
+    while (accessIdx < accesses)
+    {
+        executeMemoryOperation(accessPattern[accessIdx & 0xFFFF], (int)(accessIdx % coreCount));
+        settleBusTransactions();
+        accessIdx++;
+    }
+    return secondsSince(start);
+}
+
+// Text trace parsing and packed entry decoding, independent of geometry
+static double benchTraceParse(long long accesses)
+{
+    vector<string> lines(1 << 12);
+    size_t lineIdx = 0;
+    while (lineIdx < lines.size())
+    {
+        ostringstream line;
+        line << (lineIdx % 3 == 0 ? "W" : "R") << " 0x" << hex << (0x7f0000000000ULL + lineIdx * 0x9c40);
+        lines[lineIdx] = line.str();
+        lineIdx++;
+    }
+
+    auto start = chrono::steady_clock::now();
+    PackedTraceEntry checksum = 0;
+    long long accessIdx = 0;
+    while (accessIdx < accesses)
+    {
+        PackedTraceEntry entry;
+        parseTraceLine(lines[accessIdx & 0xFFF], entry);
+        checksum ^= entry;
+        accessIdx++;
+    }
+    double seconds = secondsSince(start);
+    benchSink = checksum;
+    return seconds;
+}
+
+static double benchTraceDecode(long long accesses)
+{
+    vector<PackedTraceEntry> entries(1 << 12);
+    size_t entryIdx = 0;
+    while (entryIdx < entries.size())
+    {
+        entries[entryIdx] = (0x7f0000000000ULL + entryIdx * 0x9c40) | (entryIdx % 3 == 0 ? TRACE_WRITE_FLAG : 0);
+        entryIdx++;
+    }
+
+    auto start = chrono::steady_clock::now();
+    unsigned long long checksum = 0;
+    long long accessIdx = 0;
+    while (accessIdx < accesses)
+    {
+        TraceRecord record = decodeTraceEntry(entries[accessIdx & 0xFFF], 6, 5);
+        checksum += record.tagBits + record.setIndex;
+        accessIdx++;
+    }
+    double seconds = secondsSince(start);
+    benchSink = checksum;
+    return seconds;
+}
+
+// Fastest of the repeats of a benchmark
+template <class Benchmark>
+static double fastestRun(Benchmark &&benchmark)
+{
+    double best = 0.0;
+    int repeatIdx = 0;
+    while (repeatIdx < BENCH_REPEATS)
+    {
+        double seconds = benchmark();
+        best = repeatIdx == 0 || seconds < best ? seconds : best;
+        repeatIdx++;
+    }
+    return best;
+}
+
+static void runMicrobenchmarks(long long accesses, vector<BenchResult> &results)
+{
+    for (const auto &geometry : benchGeometries)
+    {
+        int setBits = geometry[0];
+        int ways = geometry[1];
+        int blockBits = geometry[2];
+        string label = geometryLabel(setBits, ways, blockBits);
+        results.push_back(BenchResult{"hit", label, "", accesses, fastestRun([&] {
+            return benchHitPath(setBits, ways, blockBits, accesses);
+        })});
+        results.push_back(BenchResult{"read-miss", label, "", accesses, fastestRun([&] {
+            return benchMissPath(setBits, ways, blockBits, false, accesses);
+        })});
+        results.push_back(BenchResult{"write-miss", label, "", accesses, fastestRun([&] {
+            return benchMissPath(setBits, ways, blockBits, true, accesses);
+        })});
+        results.push_back(BenchResult{"snoop", label, "", accesses / 4, fastestRun([&] {
+            return benchSnoopPath(setBits, ways, blockBits, false, accesses / 4);
+        })});
+        results.push_back(BenchResult{"snoop-filter", label, "", accesses / 4, fastestRun([&] {
+            return benchSnoopPath(setBits, ways, blockBits, true, accesses / 4);
+        })});
+    }
+    results.push_back(BenchResult{"trace-parse", "", "", accesses / 4, fastestRun([&] {
+        return benchTraceParse(accesses / 4);
+    })});
+    results.push_back(BenchResult{"trace-decode", "", "", accesses, fastestRun([&] {
+        return benchTraceDecode(accesses);
+    })});
+}
+
+// First per-core trace file of an app that cannot be opened, or "" if all can
+static string missingTraceFile(const string &appPrefix)
+{
+    int coreIdx = 0;
+    while (coreIdx < traceCoreCount)
+    {
+        string path = appPrefix + "_proc" + to_string(coreIdx) + ".trace";
+        if (!ifstream(path).is_open())
+        {
+            return path;
+        }
+        coreIdx++;
+    }
+    return "";
+}
+
+// Load a text trace and simulate it whole in each engine at s=6 E=4 b=5
+static bool runEndToEnd(const string &appPrefix, vector<BenchResult> &results)
+{
+    long long entryCount = 0;
+    double loadSeconds = fastestRun([&] {
+        auto start = chrono::steady_clock::now();
+        bool loaded = loadProcessorTraces(appPrefix);
+        double seconds = secondsSince(start);
+        return loaded ? seconds : -1.0;
+    });
+    if (loadSeconds < 0.0)
+    {
+        return false;
+    }
+    int coreIdx = 0;
+    while (coreIdx < traceCoreCount)
+    {
+        entryCount += loadedTraces[coreIdx].length;
+        coreIdx++;
+    }
+    results.push_back(BenchResult{"load", appPrefix, "text", entryCount, loadSeconds});
+
+    const char *modes[] = {"cycle", "event-driven", "functional"};
+    for (const char *mode : modes)
+    {
+        SimulatorConfig config;
+        config.cores = traceCoreCount;
+        config.setBits = 6;
+        config.ways = 4;
+        config.blockBits = 5;
+        config.eventDriven = strcmp(mode, "event-driven") == 0;
+        config.functional = strcmp(mode, "functional") == 0;
+        double seconds = fastestRun([&] {
+            Simulator simulator;
+            simulator.configure(config);
+            simulator.attachTraces(loadedTraces, nullptr);
+            auto start = chrono::steady_clock::now();
+            simulator.run();
+            return secondsSince(start);
+        });
+        results.push_back(BenchResult{"end-to-end", appPrefix, mode, entryCount, seconds});
+    }
+    releaseTraces();
+    return true;
+}
+
+static void printResults(const vector<BenchResult> &results)
+{
+    cout << left << setw(13) << "benchmark" << setw(16) << "config" << setw(14) << "mode" << right
+         << setw(12) << "accesses" << setw(16) << "accesses/s" << setw(12) << "ns/access" << "\n";
+    for (const BenchResult &result : results)
+    {
+        double perSecond = result.seconds > 0.0 ? result.accesses / result.seconds : 0.0;
+        double nsPerAccess = result.accesses > 0 ? result.seconds * 1e9 / result.accesses : 0.0;
+        cout << left << setw(13) << result.name << setw(16) << result.config << setw(14) << result.mode << right
+             << setw(12) << result.accesses << setw(16) << fixed << setprecision(0) << perSecond << setw(12)
+             << setprecision(2) << nsPerAccess << "\n";
+    }
+}
+
+static void writeResultsJson(ostream &output, const vector<BenchResult> &results)
+{
+    output << "{\n  \"tag_match\": \"" << activeTagMatchName() << "\",\n  \"results\": [\n";
+    size_t resultIdx = 0;
+    while (resultIdx < results.size())
+    {
+        const BenchResult &result = results[resultIdx];
+        double perSecond = result.seconds > 0.0 ? result.accesses / result.seconds : 0.0;
+        double nsPerAccess = result.accesses > 0 ? result.seconds * 1e9 / result.accesses : 0.0;
+        output << "    {\"name\": \"" << result.name << "\", \"config\": \"" << result.config << "\", \"mode\": \""
+               << result.mode << "\", \"accesses\": " << result.accesses << ", \"seconds\": " << fixed
+               << setprecision(6) << result.seconds << ", \"accesses_per_second\": " << setprecision(0)
+               << perSecond << ", \"ns_per_access\": " << setprecision(3) << nsPerAccess
+               << (resultIdx + 1 < results.size() ? "},\n" : "}\n");
+        resultIdx++;
+    }
+    output << "  ]\n}\n";
+}
+
+int main(int argc, char *argv[])
+{
+    long long accesses = 2000000;
+    vector<string> appPrefixes;
+    string outputPath;
+    int argIdx = 1;
+    while (argIdx < argc)
+    {
+        if (strcmp(argv[argIdx], "-t") == 0 && argIdx + 1 < argc)
+        {
+            appPrefixes.push_back(argv[++argIdx]);
+        }
+        else if (strcmp(argv[argIdx], "-o") == 0 && argIdx + 1 < argc)
+        {
+            outputPath = argv[++argIdx];
+        }
+        else if (strcmp(argv[argIdx], "--accesses") == 0 && argIdx + 1 < argc && atoll(argv[argIdx + 1]) > 0)
+        {
+            accesses = atoll(argv[++argIdx]);
+        }
+        else
+        {
+            cerr << "Usage: " << argv[0] << " [-t <app>]... [-o <file.json>] [--accesses <n>]\n"
+                 << "  -t <app>        Also time loading and simulating <app>_procK.trace (repeatable).\n"
+                 << "  -o <file.json>  Write the results as JSON for comparison between builds.\n"
+                 << "  --accesses <n>  Accesses per microbenchmark run (default 2000000).\n";
+            return 1;
+        }
+        argIdx++;
+    }
+
+    // Check the traces before the microbenchmarks so a missing one is
+    // reported at once; its end-to-end runs are skipped, not the rest
+    vector<string> presentApps;
+    for (const string &appPrefix : appPrefixes)
+    {
+        string missing = missingTraceFile(appPrefix);
+        if (!missing.empty())
+        {
+            cerr << "Warning: Skipping end-to-end runs of " << appPrefix << ": cannot open " << missing << ".\n";
+            continue;
+        }
+        presentApps.push_back(appPrefix);
+    }
+
+    vector<BenchResult> results;
+    runMicrobenchmarks(accesses, results);
+    for (const string &appPrefix : presentApps)
+    {
+        if (!runEndToEnd(appPrefix, results))
+        {
+            cerr << "Warning: Skipping end-to-end runs of " << appPrefix << ": the trace did not load.\n";
+        }
+    }
+
+    printResults(results);
+    if (!outputPath.empty())
+    {
+        ofstream outputFile(outputPath);
+        if (!outputFile.is_open())
+        {
+            cerr << "Error: Could not open output file " << outputPath << endl;
+            return 1;
+        }
+        writeResultsJson(outputFile, results);
+    }
+    return 0;
+}
@@ -9,273 +9,352 @@
 #include "main.hpp"
 #include "bus.hpp"
 #include "cache.hpp"
+#include "llc.hpp"
+#include "snoop.hpp"
+#include "state.hpp"
+#include "profile.hpp"
 
-vector<int> pendingOperations(4, -1);
-bool busOccupied = false;
-int busTickCounter = 0;
-int debugCounter = 0;
+void initializeBus()
+{
+    sim->pendingOperations.assign(sim->numCores, -1);
+    sim->requestQueued.assign(sim->numCores, false);
+    sim->busOccupied = false;
+    sim->busTickCounter = 0;
+    sim->snoopedCoreMask = 0;
+    sim->allCoresMask = sim->numCores == 64 ? ~0ULL : (1ULL << sim->numCores) - 1;
+
+    // At most one queued request per core; transfers rarely exceed that either
+    sim->pendingRequests = RingQueue<BusTransaction>(2 * sim->numCores);
+    sim->dataTransferQueue = RingQueue<BusDataTransfer>(2 * sim->numCores);
+}
+
+void issueBusRequest(int processorId, unsigned long long memoryAddress, BusRequestType reqType)
+{
+    // Cores issue before the bus ticks, so this cycle's tick is the next one
+    sim->pendingRequests.push_back(BusTransaction{processorId, memoryAddress, reqType, sim->busTickCounter + 1});
+    sim->requestQueued[processorId] = true;
+    sim->processorCaches[processorId].isStalled = true;
+}
+
+bool hasQueuedRequest(int processorId)
+{
+    return sim->requestQueued[processorId];
+}
+
+int cyclesUntilBusEvent()
+{
+    // Queued requests cannot be granted before the transfers drain
+    if (!sim->busOccupied || sim->dataTransferQueue.empty())
+    {
+        return 0;
+    }
+    return sim->dataTransferQueue.front().pendingCycles;
+}
+
+void skipBusCycles(int cycles)
+{
+    sim->busTickCounter += cycles;
+    sim->busBusyCycles += cycles;
+    sim->dataTransferQueue.front().pendingCycles -= cycles;
+}
+
+// Peer caches a coherence action has to look in: every other core, or only
+// the recorded sharers of the block when the snoop filter is on
+static unsigned long long snoopTargets(int requestorCore, int setIndex, unsigned long long tagBits)
+{
+    unsigned long long peers = sim->allCoresMask & ~(1ULL << requestorCore);
+    if (!sim->snoopFilterEnabled)
+    {
+        return peers;
+    }
+    return peers & sim->sharerDirectory.sharers(setIndex, tagBits);
+}
+
+// Lookups a full broadcast would make when it stops at the first holder
+// (firstHolder == -1 when no peer holds the block)
+static int broadcastProbesUntil(int requestorCore, int firstHolder)
+{
+    if (firstHolder == -1)
+    {
+        return sim->numCores - 1;
+    }
+    return firstHolder + (requestorCore < firstHolder ? 0 : 1);
+}
+
+// Invalidation broadcasts visit only the targets; with the filter on, the
+// peers left out count as avoided snoops and the targets lose their bit
+static void dropInvalidatedSharers(unsigned long long targets, int setIndex, unsigned long long tagBits)
+{
+    if (!sim->snoopFilterEnabled)
+    {
+        return;
+    }
+    sim->snoopsAvoided += sim->numCores - 1 - __builtin_popcountll(targets);
+    while (targets != 0)
+    {
+        int otherCore = __builtin_ctzll(targets);
+        targets &= targets - 1;
+        sim->sharerDirectory.removeSharer(otherCore, setIndex, tagBits);
+    }
+}
+
+void settleBusTransactions()
+{
+    // Each pass grants a request if the bus is free and retires the transfer
+    // at the head of the queue, whose countdown is skipped
+    while (!sim->pendingRequests.empty() || !sim->dataTransferQueue.empty())
+    {
+        if (!sim->dataTransferQueue.empty())
+        {
+            sim->dataTransferQueue.front().pendingCycles = 0;
+        }
+        processBusTransactions();
+    }
+}
 
 void processBusTransactions()
 {
-    busTickCounter++;
+    sim->busTickCounter++;
     
-    while (pendingRequests.size())
+    // Grant the oldest request once the bus is free; the rest stay queued
+    while (!sim->busOccupied && !sim->pendingRequests.empty())
     {
-        BusTransaction currentReq = pendingRequests.front();
-        pendingRequests.erase(pendingRequests.begin());
+        PROFILE_SCOPE(HostPhase::BUS_REQUEST);
+        BusTransaction currentReq = sim->pendingRequests.front();
+        sim->pendingRequests.pop_front();
 
         int requestorCore = currentReq.requestorId;
-        int targetAddr = currentReq.memoryAddress;
+        unsigned long long targetAddr = currentReq.memoryAddress;
         BusRequestType requestType = currentReq.reqType;
 
-        int setIndex = (targetAddr >> numBlockBits) & ((1 << numSetBits) - 1);
-        int tagBits = targetAddr >> (numSetBits + numBlockBits);
+        int setIndex = (targetAddr >> sim->numBlockBits) & ((1ULL << sim->numSetBits) - 1);
+        unsigned long long tagBits = targetAddr >> (sim->numSetBits + sim->numBlockBits);
 
-        if (busOccupied)
+        // Every tick spent queued behind a busy bus is a stall cycle
+        sim->requestQueued[requestorCore] = false;
+        sim->stalledCycles[requestorCore] += sim->busTickCounter - currentReq.issueTick;
+        sim->pendingOperations[requestorCore] = 1;
+
+        // A shared copy invalidated while its upgrade waited needs the whole block
+        int upgradeWay = -1;
+        if (requestType == BusRequestType::UPGRADE_REQUEST)
         {
-            processorCaches[requestorCore].isStalled = true;
-            stalledCycles[requestorCore]++;
-            continue;
+            const CoherenceState *ownStates = sim->processorCaches[requestorCore].statesOf(setIndex);
+            sim->processorCaches[requestorCore].forEachMatchingWay(setIndex, tagBits, [&](int wayIdx) {
+                if (upgradeWay == -1 && ownStates[wayIdx] == CoherenceState::SHARED)
+                {
+                    upgradeWay = wayIdx;
+                }
+            });
+            if (upgradeWay == -1)
+            {
+                requestType = BusRequestType::READ_EXCLUSIVE;
+            }
         }
         
-        pendingOperations[requestorCore] = targetAddr;
-        
         if (requestType == BusRequestType::READ_SHARED)
         {
-            busOccupied = true;
-            busTransactionCount++;
-            missCount[requestorCore]++;
+            sim->busOccupied = true;
+            sim->busTransactionCount++;
+            sim->missCount[requestorCore]++;
             
             bool foundInOther = false;
-            int otherCore = 0;
+            int snoopProbes = 0;
+            int otherCore = -1;
+            unsigned long long targets = snoopTargets(requestorCore, setIndex, tagBits);
             
-            while (otherCore < 4)
+            while (targets != 0)
             {
-                if (otherCore != requestorCore)
+                otherCore = __builtin_ctzll(targets);
+                targets &= targets - 1;
+                snoopProbes++;
+                int wayIdx = sim->processorCaches[otherCore].findWay(setIndex, tagBits);
+                if (wayIdx != -1)
                 {
-                    int wayIdx = 0;
-                    while (wayIdx < associativity)
+                    CoherenceState &otherState = sim->processorCaches[otherCore].statesOf(setIndex)[wayIdx];
+                    foundInOther = true;
+                    sim->processorCaches[requestorCore].isStalled = true;
+                    sim->dataTransferQueue.push_back(BusDataTransfer{targetAddr, requestorCore, false, false, false, 1 << (sim->numBlockBits - 1)});
+                    sim->trafficBytes[otherCore] += sim->processorCaches[otherCore].bytesPerBlock;
+                    
+                    if (otherState == CoherenceState::MODIFIED)
                     {
-                        if (processorCaches[otherCore].tagArray[setIndex][wayIdx] == tagBits && 
-                            coherenceTable[otherCore][setIndex][wayIdx] != CoherenceState::INVALID)
+                        sim->snoopedCoreMask |= 1ULL << otherCore;
+                        otherState = CoherenceState::SHARED;
+                        sim->processorCaches[otherCore].isStalled = true;
+                        bool intoLlc = llcTakesWriteback(otherCore, targetAddr, false);
+                        int writebackTime = writebackCycles(intoLlc);
+                        sim->dataTransferQueue.push_back(BusDataTransfer{targetAddr, otherCore, false, true, false, writebackTime, intoLlc});
+                        if (sim->processorRunning[otherCore])
                         {
-                            foundInOther = true;
-                            processorCaches[requestorCore].isStalled = true;
-                            dataTransferQueue.push_back(BusDataTransfer{targetAddr, requestorCore, false, false, false, 1 << (numBlockBits - 1)});
-                            trafficBytes[otherCore] += processorCaches[otherCore].bytesPerBlock;
-                            
-                            if (coherenceTable[otherCore][setIndex][wayIdx] == CoherenceState::MODIFIED)
-                            {
-                                coherenceTable[otherCore][setIndex][wayIdx] = CoherenceState::SHARED;
-                                processorCaches[otherCore].isStalled = true;
-                                dataTransferQueue.push_back(BusDataTransfer{targetAddr, otherCore, false, true, false, 100});
-                                if (processorRunning[otherCore])
-                                {
-                                    totalCycles[otherCore] -= ((1 << (numBlockBits - 1)) + 101);
-                                    stalledCycles[otherCore] += (1 << (numBlockBits - 1)) + 1;
-                                }
-                                pendingOperations[otherCore] = targetAddr;
-                            }
-                            else if (coherenceTable[otherCore][setIndex][wayIdx] == CoherenceState::EXCLUSIVE)
-                            {
-                                coherenceTable[otherCore][setIndex][wayIdx] = CoherenceState::SHARED;
-                            }
-                            break;
+                            sim->totalCycles[otherCore] -= ((1 << (sim->numBlockBits - 1)) + writebackTime + 1);
+                            sim->stalledCycles[otherCore] += (1 << (sim->numBlockBits - 1)) + 1;
                         }
-                        wayIdx++;
+                        sim->pendingOperations[otherCore] = 1;
+                    }
+                    else if (otherState == CoherenceState::EXCLUSIVE)
+                    {
+                        sim->snoopedCoreMask |= 1ULL << otherCore;
+                        otherState = CoherenceState::SHARED;
                     }
-                }
-                if (foundInOther)
-                {
                     break;
                 }
-                otherCore++;
+            }
+            if (sim->snoopFilterEnabled)
+            {
+                sim->snoopsAvoided += broadcastProbesUntil(requestorCore, foundInOther ? otherCore : -1) - snoopProbes;
             }
             
             if (!foundInOther)
             {
-                processorCaches[requestorCore].isStalled = true;
-                dataTransferQueue.push_back(BusDataTransfer{targetAddr, requestorCore, false, false, false, 100});
+                sim->processorCaches[requestorCore].isStalled = true;
+                sim->dataTransferQueue.push_back(BusDataTransfer{targetAddr, requestorCore, false, false, false, fetchFromLlc(targetAddr)});
             }
         }
         else if (requestType == BusRequestType::READ_EXCLUSIVE)
         {
-            busOccupied = true;
-            busTransactionCount++;
-            missCount[requestorCore]++;
+            sim->busOccupied = true;
+            sim->busTransactionCount++;
+            sim->missCount[requestorCore]++;
             
             bool foundInOther = false;
-            int otherCore = 0;
+            unsigned long long targets = snoopTargets(requestorCore, setIndex, tagBits);
+            dropInvalidatedSharers(targets, setIndex, tagBits);
             
-            while (otherCore < 4)
+            while (targets != 0)
             {
-                if (otherCore != requestorCore)
-                {
-                    int wayIdx = 0;
-                    while (wayIdx < associativity)
+                int otherCore = __builtin_ctzll(targets);
+                targets &= targets - 1;
+                CoherenceState *otherStates = sim->processorCaches[otherCore].statesOf(setIndex);
+                sim->processorCaches[otherCore].forEachMatchingWay(setIndex, tagBits, [&](int wayIdx) {
+                    foundInOther = true;
+                    sim->snoopedCoreMask |= 1ULL << otherCore;
+                    
+                    if (otherStates[wayIdx] == CoherenceState::MODIFIED)
                     {
-                        if (processorCaches[otherCore].tagArray[setIndex][wayIdx] == tagBits && 
-                            coherenceTable[otherCore][setIndex][wayIdx] != CoherenceState::INVALID)
-                        {
-                            foundInOther = true;
-                            
-                            if (coherenceTable[otherCore][setIndex][wayIdx] == CoherenceState::MODIFIED)
-                            {
-                                processorCaches[otherCore].isStalled = true;
-                                dataTransferQueue.push_back(BusDataTransfer{targetAddr, otherCore, false, true, false, 100});
-                                if (processorRunning[otherCore])
-                                    totalCycles[otherCore] -= 101;
-                                pendingOperations[otherCore] = targetAddr;
-                            }
-                            coherenceTable[otherCore][setIndex][wayIdx] = CoherenceState::INVALID;
-                        }
-                        wayIdx++;
+                        sim->processorCaches[otherCore].isStalled = true;
+                        bool intoLlc = llcTakesWriteback(otherCore, targetAddr, false);
+                        int writebackTime = writebackCycles(intoLlc);
+                        sim->dataTransferQueue.push_back(BusDataTransfer{targetAddr, otherCore, false, true, false, writebackTime, intoLlc});
+                        if (sim->processorRunning[otherCore])
+                            sim->totalCycles[otherCore] -= writebackTime + 1;
+                        sim->pendingOperations[otherCore] = 1;
                     }
-                }
-                otherCore++;
+                    otherStates[wayIdx] = CoherenceState::INVALID;
+                });
             }
             
-            processorCaches[requestorCore].isStalled = true;
+            sim->processorCaches[requestorCore].isStalled = true;
             if (foundInOther)
-                invalidationCount[requestorCore]++;
-            dataTransferQueue.push_back(BusDataTransfer{targetAddr, requestorCore, true, false, false, 100});
+                sim->invalidationCount[requestorCore]++;
+            sim->dataTransferQueue.push_back(BusDataTransfer{targetAddr, requestorCore, true, false, false, fetchFromLlc(targetAddr)});
         }
-        else if (requestType == BusRequestType::UPGRADE_REQUEST)
+        else    // UPGRADE_REQUEST with the shared copy still present
         {
-            int targetWay = -1;
-            int wayIdx = 0;
-            
-            while (wayIdx < associativity)
-            {
-                if (processorCaches[requestorCore].tagArray[setIndex][wayIdx] == tagBits && 
-                    coherenceTable[requestorCore][setIndex][wayIdx] == CoherenceState::SHARED)
-                {
-                    targetWay = wayIdx;
-                    break;
-                }
-                wayIdx++;
-            }
+            sim->busTransactionCount++;
 
-            if (targetWay != -1)
+            // Invalidate in other caches
+            unsigned long long targets = snoopTargets(requestorCore, setIndex, tagBits);
+            dropInvalidatedSharers(targets, setIndex, tagBits);
+            while (targets != 0)
             {
-                busTransactionCount++;
-
-                // Invalidate in other caches
-                int otherCore = 0;
-                while (otherCore < 4)
-                {
-                    if (otherCore != requestorCore)
-                    {
-                        int searchWay = 0;
-                        while (searchWay < associativity)
-                        {
-                            if (processorCaches[otherCore].tagArray[setIndex][searchWay] == tagBits && 
-                                coherenceTable[otherCore][setIndex][searchWay] != CoherenceState::INVALID)
-                            {
-                                coherenceTable[otherCore][setIndex][searchWay] = CoherenceState::INVALID;
-                            }
-                            searchWay++;
-                        }
-                    }
-                    otherCore++;
-                }
-
-                // Upgrade to modified
-                invalidationCount[requestorCore]++;
-                busOccupied = true;
-                coherenceTable[requestorCore][setIndex][targetWay] = CoherenceState::MODIFIED;
-                processorCaches[requestorCore].dirtyFlags[setIndex][targetWay] = true;
-                processorCaches[requestorCore].isStalled = true;
-                dataTransferQueue.push_back(BusDataTransfer{targetAddr, requestorCore, false, false, true, 0});
-                pendingOperations[requestorCore] = 1;
+                int otherCore = __builtin_ctzll(targets);
+                targets &= targets - 1;
+                CoherenceState *otherStates = sim->processorCaches[otherCore].statesOf(setIndex);
+                sim->processorCaches[otherCore].forEachMatchingWay(setIndex, tagBits, [&](int wayIdx) {
+                    sim->snoopedCoreMask |= 1ULL << otherCore;
+                    otherStates[wayIdx] = CoherenceState::INVALID;
+                });
             }
+
+            // Upgrade to modified
+            sim->invalidationCount[requestorCore]++;
+            sim->busOccupied = true;
+            sim->processorCaches[requestorCore].statesOf(setIndex)[upgradeWay] = CoherenceState::MODIFIED;
+            sim->processorCaches[requestorCore].dirtyOf(setIndex)[upgradeWay] = true;
+            sim->processorCaches[requestorCore].isStalled = true;
+            sim->dataTransferQueue.push_back(BusDataTransfer{targetAddr, requestorCore, false, false, true, 0});
+            sim->pendingOperations[requestorCore] = 1;
         }
     }
     
     // Process data transfers
-    if (!dataTransferQueue.empty())
+    if (!sim->dataTransferQueue.empty())
     {
-        BusDataTransfer &currentTransfer = dataTransferQueue.front();
+        BusDataTransfer &currentTransfer = sim->dataTransferQueue.front();
+        sim->busBusyCycles++;
         
         if (currentTransfer.pendingCycles == 0)
         {
-            totalBusTraffic += processorCaches[currentTransfer.destinationCore].bytesPerBlock;
+            PROFILE_SCOPE(HostPhase::DATA_TRANSFER);
+            sim->totalBusTraffic += sim->processorCaches[currentTransfer.destinationCore].bytesPerBlock;
             
             int destCore = currentTransfer.destinationCore;
-            int transferAddr = currentTransfer.targetAddress;
+            unsigned long long transferAddr = currentTransfer.targetAddress;
             bool isWriteOp = currentTransfer.isWriteOp;
             bool isWritebackOp = currentTransfer.isWritebackOp;
             bool isInvOp = currentTransfer.isInvalidation;
-            trafficBytes[destCore] += processorCaches[destCore].bytesPerBlock;
+            sim->trafficBytes[destCore] += sim->processorCaches[destCore].bytesPerBlock;
             bool evictTriggeredWb = false;
             
             if (!isWritebackOp)
             {
-                int setIdx = (transferAddr >> numBlockBits) & ((1 << numSetBits) - 1);
-                int tagVal = transferAddr >> (numSetBits + numBlockBits);
+                int setIdx = (transferAddr >> sim->numBlockBits) & ((1ULL << sim->numSetBits) - 1);
+                unsigned long long tagVal = transferAddr >> (sim->numSetBits + sim->numBlockBits);
                 
                 if (isWriteOp)
                 {
                     int allocatedWay = processWriteMiss(destCore, setIdx, tagVal, evictTriggeredWb);
-                    coherenceTable[destCore][setIdx][allocatedWay] = CoherenceState::MODIFIED;
+                    sim->processorCaches[destCore].statesOf(setIdx)[allocatedWay] = CoherenceState::MODIFIED;
                 }
                 else if (!isInvOp)
                 {
                     int allocatedWay = processReadMiss(destCore, setIdx, tagVal, evictTriggeredWb);
                     bool othersHaveData = false;
                     
-                    int checkCore = 0;
-                    while (checkCore < 4)
-                    {
-                        if (checkCore != destCore)
-                        {
-                            int checkWay = 0;
-                            while (checkWay < associativity)
-                            {
-                                if (processorCaches[checkCore].tagArray[setIdx][checkWay] == tagVal && 
-                                    coherenceTable[checkCore][setIdx][checkWay] != CoherenceState::INVALID)
-                                {
-                                    othersHaveData = true;
-                                    break;
-                                }
-                                checkWay++;
-                            }
-                        }
-                        if (othersHaveData)
-                            break;
-                        checkCore++;
-                    }
-                    
-                    if (othersHaveData)
+                    if (sim->snoopFilterEnabled)
                     {
-                        coherenceTable[destCore][setIdx][allocatedWay] = CoherenceState::SHARED;
+                        // The directory answers without probing any peer
+                        unsigned long long peers = snoopTargets(destCore, setIdx, tagVal);
+                        othersHaveData = peers != 0;
+                        sim->snoopsAvoided += broadcastProbesUntil(destCore, othersHaveData ? __builtin_ctzll(peers) : -1);
                     }
                     else
                     {
-                        coherenceTable[destCore][setIdx][allocatedWay] = CoherenceState::EXCLUSIVE;
+                        int checkCore = 0;
+                        while (checkCore < sim->numCores && !othersHaveData)
+                        {
+                            othersHaveData = checkCore != destCore && sim->processorCaches[checkCore].findWay(setIdx, tagVal) != -1;
+                            checkCore++;
+                        }
                     }
+                    
+                    sim->processorCaches[destCore].statesOf(setIdx)[allocatedWay] =
+                        othersHaveData ? CoherenceState::SHARED : CoherenceState::EXCLUSIVE;
                 }
                 
-                processorCaches[destCore].isStalled = false;
-                pendingOperations[destCore] = -1;
+                sim->processorCaches[destCore].isStalled = false;
+                sim->pendingOperations[destCore] = -1;
                 
                 if (evictTriggeredWb)
                 {
-                    processorCaches[destCore].isStalled = true;
-                    pendingOperations[destCore] = 1;
+                    sim->processorCaches[destCore].isStalled = true;
+                    sim->pendingOperations[destCore] = 1;
                 }
             }
             else
             {
-                writebackCount[destCore]++;
-                processorCaches[destCore].isStalled = false;
-                pendingOperations[destCore] = -1;
+                // A core whose dirty line was snooped may still have its own request queued
+                sim->writebackCount[destCore]++;
+                completeWriteback(transferAddr, currentTransfer.intoLlc);
+                sim->processorCaches[destCore].isStalled = hasQueuedRequest(destCore);
+                sim->pendingOperations[destCore] = -1;
             }
 
-            dataTransferQueue.erase(dataTransferQueue.begin());
-            if (dataTransferQueue.empty())
+            sim->dataTransferQueue.pop_front();
+            if (sim->dataTransferQueue.empty())
             {
-                busOccupied = false;
+                sim->busOccupied = false;
             }
         }
         else
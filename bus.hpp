@@ -5,9 +5,24 @@
 #include <set>
 using namespace std;
 
+// Reset the bus and size its per-core state and queues for numCores cores
+void initializeBus();
+
 // Process bus transactions for MESI protocol
 void processBusTransactions();
 
+// Functional mode: grant every queued request and finish every transfer at
+// once, so the access that issued them completes without bus timing
+void settleBusTransactions();
+
+// Cycles during which processBusTransactions only counts down the transfer
+// at the head of the queue and rejects new requests (0 if something
+// happens next cycle)
+int cyclesUntilBusEvent();
+
+// Apply the effect of that many countdown-only bus cycles at once
+void skipBusCycles(int cycles);
+
 // Types of bus requests in MESI coherence protocol
 enum class BusRequestType {
     READ_SHARED,        // Read request - others may have shared/modified copy
@@ -18,20 +33,85 @@ enum class BusRequestType {
 // Structure representing a bus transaction request
 struct BusTransaction {
     int requestorId;            // ID of requesting processor
-    int memoryAddress;          // Target memory address
+    unsigned long long memoryAddress;   // Target memory address
     BusRequestType reqType;     // Type of bus request
+    long long issueTick;        // Bus tick that first arbitrated the request
 };
 
 // Structure for data transfer on bus
 struct BusDataTransfer {
-    int targetAddress;          // Memory address of cache line
+    unsigned long long targetAddress;   // Memory address of cache line
     int destinationCore;        // ID of receiving processor
     bool isWriteOp;             // Read or write operation
     bool isWritebackOp;         // Writeback to memory flag
     bool isInvalidation;        // Invalidation signal
     int pendingCycles;          // Remaining cycles for transaction
+    bool intoLlc = false;       // Writeback lands in the shared LLC, not memory
 };
 
-extern vector<BusTransaction> pendingRequests;
-extern vector<BusDataTransfer> dataTransferQueue;
+// FIFO ring buffer with O(1) enqueue and dequeue. Storage is allocated once
+// and only doubles if a push finds it full, so steady-state cycles never
+// allocate.
+template <class T>
+class RingQueue
+{
+public:
+    explicit RingQueue(size_t minCapacity = 16) : head(0), count(0)
+    {
+        size_t capacity = 1;
+        while (capacity < minCapacity)
+        {
+            capacity <<= 1;
+        }
+        slots.resize(capacity);
+    }
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    T &front() { return slots[head]; }
+    const T &at(size_t idx) const { return slots[(head + idx) & (slots.size() - 1)]; }
+
+    void push_back(const T &item)
+    {
+        if (count == slots.size())
+        {
+            grow();
+        }
+        slots[(head + count) & (slots.size() - 1)] = item;
+        count++;
+    }
+
+    void pop_front()
+    {
+        head = (head + 1) & (slots.size() - 1);
+        count--;
+    }
+
+private:
+    // Capacity stays a power of two so indices wrap with a mask
+    void grow()
+    {
+        vector<T> larger(slots.size() * 2);
+        size_t idx = 0;
+        while (idx < count)
+        {
+            larger[idx] = slots[(head + idx) & (slots.size() - 1)];
+            idx++;
+        }
+        slots.swap(larger);
+        head = 0;
+    }
+
+    vector<T> slots;
+    size_t head;
+    size_t count;
+};
+
+// Queue a bus request for a processor and stall it. The request stays
+// queued, in arrival order, until it wins arbitration for a free bus.
+void issueBusRequest(int processorId, unsigned long long memoryAddress, BusRequestType reqType);
+
+// True if the processor has a request waiting in pendingRequests
+bool hasQueuedRequest(int processorId);
+
 #endif // BUS_HPP
@@ -8,244 +8,274 @@
 #include <cstdlib>
 #include "main.hpp"
 #include "bus.hpp"
+#include "cache.hpp"
+#include "llc.hpp"
+#include "replacement.hpp"
+#include "snoop.hpp"
+#include "state.hpp"
+#include "profile.hpp"
 
 using namespace std;
 
-// External references
-extern vector<int> pendingOperations;
-extern vector<int> readCount;
-extern vector<int> writeCount;
-extern vector<int> missCount;
-extern vector<int> evictionCount;
-extern vector<int> writebackCount;
-extern vector<long long> trafficBytes;
+const char *replacementPolicyName(ReplacementPolicy policy)
+{
+    switch (policy)
+    {
+    case ReplacementPolicy::PLRU:
+        return "Tree-PLRU (Pseudo-LRU)";
+    case ReplacementPolicy::SRRIP:
+        return "SRRIP (Static RRIP)";
+    case ReplacementPolicy::BRRIP:
+        return "BRRIP (Bimodal RRIP)";
+    case ReplacementPolicy::NRU:
+        return "NRU (Not Recently Used)";
+    case ReplacementPolicy::RANDOM:
+        return "Random";
+    case ReplacementPolicy::LRU:
+    default:
+        return "LRU (Least Recently Used)";
+    }
+}
 
-int operationCounter = 0;
+// Option spellings accepted by -r, also used as short names in sweep tables
+static const pair<const char *, ReplacementPolicy> policyKeys[] = {
+    {"lru", ReplacementPolicy::LRU}, {"plru", ReplacementPolicy::PLRU},
+    {"srrip", ReplacementPolicy::SRRIP}, {"brrip", ReplacementPolicy::BRRIP},
+    {"nru", ReplacementPolicy::NRU}, {"random", ReplacementPolicy::RANDOM}
+};
 
-int convertHexToInt(const string &hexString)
+const char *replacementPolicyKey(ReplacementPolicy policy)
 {
-    string hexDigits = hexString;
-    if (hexDigits.length() >= 2 && (hexDigits.substr(0, 2) == "0x" || hexDigits.substr(0, 2) == "0X"))
+    for (const auto &entry : policyKeys)
     {
-        hexDigits = hexDigits.substr(2);
+        if (policy == entry.second)
+        {
+            return entry.first;
+        }
     }
-    int addressValue = stoul(hexDigits, nullptr, 16);
-    stringstream formatter;
-    formatter << "0x" << setfill('0') << setw(8) << hex << addressValue;
-    string paddedResult = formatter.str();
-
-    return addressValue;
+    return "lru";
 }
 
-int processReadMiss(int processorId, int setIndex, int tagValue, bool &triggeredWriteback)
+bool parseReplacementPolicy(const string &name, ReplacementPolicy &policy)
 {
-    CacheUnit &targetCache = processorCaches[processorId];
-    int selectedWay = -1;
-
-    // Search for invalid line first
-    int wayIdx = 0;
-    while (wayIdx < associativity)
+    for (const auto &entry : policyKeys)
     {
-        if (coherenceTable[processorId][setIndex][wayIdx] == CoherenceState::INVALID)
+        if (name == entry.first)
         {
-            selectedWay = wayIdx;
-            break;
+            policy = entry.second;
+            return true;
         }
-        wayIdx++;
     }
+    return false;
+}
+
+const char *geometryError(int ways, ReplacementPolicy policy)
+{
+    if (ways < 1 || ways > 255)
+    {
+        return "Associativity (-E) must be between 1 and 255.";
+    }
+    if (policy == ReplacementPolicy::PLRU && (ways & (ways - 1)) != 0)
+    {
+        return "Tree-PLRU replacement needs a power-of-two associativity.";
+    }
+    return nullptr;
+}
+
+void initializeReplacement(CacheUnit &cache, ReplacementPolicy policy)
+{
+    dispatchReplacement(policy, [&](auto policy) {
+        int setIdx = 0;
+        while (setIdx < cache.totalSets)
+        {
+            decltype(policy)::initSet(cache, setIdx);
+            setIdx++;
+        }
+    });
+}
+
+// Pick the way to fill for a miss: first invalid way, else the policy's
+// victim (queueing a writeback if it is dirty). The policy sees the fill.
+template <class Policy>
+static int allocateLine(int processorId, int setIndex, bool &triggeredWriteback)
+{
+    CacheUnit &targetCache = sim->processorCaches[processorId];
+
+    // Search for invalid line first
+    int selectedWay = targetCache.findState(setIndex, CoherenceState::INVALID);
 
-    // If all valid, evict LRU block
+    // If all valid, evict the replacement victim
     if (selectedWay == -1)
     {
-        selectedWay = targetCache.lruOrder[setIndex].front();
-        targetCache.lruOrder[setIndex].erase(targetCache.lruOrder[setIndex].begin());
-        evictionCount[processorId]++;
+        selectedWay = Policy::victim(targetCache, setIndex);
+        sim->evictionCount[processorId]++;
 
-        if (targetCache.dirtyFlags[setIndex][selectedWay])
+        unsigned long long evictedTag = targetCache.tagAt(setIndex, selectedWay);
+        unsigned long long evictedAddr = (evictedTag << (sim->numSetBits + sim->numBlockBits)) |
+                                         ((unsigned long long)setIndex << sim->numBlockBits);
+        if (targetCache.dirtyOf(setIndex)[selectedWay])
         {
-            processorCaches[processorId].isStalled = true;
-            int evictedTag = targetCache.tagArray[setIndex][selectedWay];
-            int evictedAddr = (evictedTag << (numSetBits + numBlockBits)) | (setIndex << numBlockBits);
-            dataTransferQueue.push_back(BusDataTransfer{evictedAddr, processorId, false, true, false, 100});
+            bool intoLlc = llcTakesWriteback(processorId, evictedAddr, true);
+            sim->dataTransferQueue.push_back(
+                BusDataTransfer{evictedAddr, processorId, false, true, false, writebackCycles(intoLlc), intoLlc});
             triggeredWriteback = true;
         }
-    }
-    else
-    {
-        // Remove from LRU if present
-        auto foundIt = find(targetCache.lruOrder[setIndex].begin(), targetCache.lruOrder[setIndex].end(), selectedWay);
-        if (foundIt != targetCache.lruOrder[setIndex].end())
+        else
         {
-            targetCache.lruOrder[setIndex].erase(foundIt);
+            evictCleanLine(processorId, evictedAddr);
         }
     }
 
-    // Update cache metadata
-    targetCache.tagArray[setIndex][selectedWay] = tagValue;
-    targetCache.dirtyFlags[setIndex][selectedWay] = false;
-    targetCache.lruOrder[setIndex].push_back(selectedWay);
+    Policy::onFill(targetCache, setIndex, selectedWay);
     return selectedWay;
 }
 
-int processWriteMiss(int processorId, int setIndex, int tagValue, bool &triggeredWriteback)
+// Install a new tag, keeping the sharer directory in step with the block it
+// replaces (a valid victim) and the block it brings in
+static void trackFill(int processorId, int setIndex, int selectedWay, unsigned long long tagValue)
 {
-    CacheUnit &targetCache = processorCaches[processorId];
-    int selectedWay = -1;
-
-    // Search for invalid line
-    int wayIdx = 0;
-    while (wayIdx < associativity)
+    CacheUnit &targetCache = sim->processorCaches[processorId];
+    if (!sim->snoopFilterEnabled)
     {
-        if (coherenceTable[processorId][setIndex][wayIdx] == CoherenceState::INVALID)
-        {
-            selectedWay = wayIdx;
-            break;
-        }
-        wayIdx++;
+        targetCache.setTag(setIndex, selectedWay, tagValue);
+        return;
     }
 
-    // Evict LRU if necessary
-    if (selectedWay == -1)
+    unsigned long long evictedTag = targetCache.tagAt(setIndex, selectedWay);
+    bool evictedValid = targetCache.statesOf(setIndex)[selectedWay] != CoherenceState::INVALID;
+    targetCache.setTag(setIndex, selectedWay, tagValue);
+    if (evictedValid && targetCache.findWay(setIndex, evictedTag) == -1)
     {
-        selectedWay = targetCache.lruOrder[setIndex].front();
-        targetCache.lruOrder[setIndex].erase(targetCache.lruOrder[setIndex].begin());
-        evictionCount[processorId]++;
-        
-        if (targetCache.dirtyFlags[setIndex][selectedWay])
-        {
-            int evictedTag = targetCache.tagArray[setIndex][selectedWay];
-            int evictedAddr = (evictedTag << (numSetBits + numBlockBits)) | (setIndex << numBlockBits);
-            dataTransferQueue.push_back(BusDataTransfer{evictedAddr, processorId, false, true, false, 100});
-            triggeredWriteback = true;
-        }
+        sim->sharerDirectory.removeSharer(processorId, setIndex, evictedTag);
     }
-    else
+    sim->sharerDirectory.addSharer(processorId, setIndex, tagValue);
+}
+
+int processReadMiss(int processorId, int setIndex, unsigned long long tagValue, bool &triggeredWriteback)
+{
+    int selectedWay = dispatchReplacement(sim->replacementPolicy, [&](auto policy) {
+        return allocateLine<decltype(policy)>(processorId, setIndex, triggeredWriteback);
+    });
+    if (triggeredWriteback)
     {
-        auto foundIt = find(targetCache.lruOrder[setIndex].begin(), targetCache.lruOrder[setIndex].end(), selectedWay);
-        if (foundIt != targetCache.lruOrder[setIndex].end())
-        {
-            targetCache.lruOrder[setIndex].erase(foundIt);
-        }
+        sim->processorCaches[processorId].isStalled = true;
     }
 
+    // Update cache metadata
+    trackFill(processorId, setIndex, selectedWay, tagValue);
+    sim->processorCaches[processorId].dirtyOf(setIndex)[selectedWay] = false;
+    return selectedWay;
+}
+
+int processWriteMiss(int processorId, int setIndex, unsigned long long tagValue, bool &triggeredWriteback)
+{
+    int selectedWay = dispatchReplacement(sim->replacementPolicy, [&](auto policy) {
+        return allocateLine<decltype(policy)>(processorId, setIndex, triggeredWriteback);
+    });
+
     // Update metadata for write
-    targetCache.tagArray[setIndex][selectedWay] = tagValue;
-    targetCache.dirtyFlags[setIndex][selectedWay] = true;
-    targetCache.lruOrder[setIndex].push_back(selectedWay);
+    trackFill(processorId, setIndex, selectedWay, tagValue);
+    sim->processorCaches[processorId].dirtyOf(setIndex)[selectedWay] = true;
     return selectedWay;
 }
 
-void executeMemoryOperation(pair<char, const char *> traceEntry, int processorId)
+bool isWaitingOnBus(int processorId)
 {
-    operationCounter++;
-    
-    char opType = traceEntry.first;
-    string addressStr = traceEntry.second;
+    return sim->processorCaches[processorId].isStalled &&
+           (sim->pendingOperations[processorId] != -1 || hasQueuedRequest(processorId));
+}
 
-    int memAddr = convertHexToInt(addressStr);
-    
-    // Skip if pending operation exists
-    if (pendingOperations[processorId] != -1)
+void skipWaitingCycles(int processorId, int cycles)
+{
+    // Queued requests are charged their stall cycles when granted
+    sim->operationCounter += cycles;
+    if (sim->pendingOperations[processorId] != -1)
     {
-        totalCycles[processorId]++;
-        return;
+        sim->totalCycles[processorId] += cycles;
     }
+}
 
-    // Extract cache indexing fields
-    int setIndex = (memAddr >> numBlockBits) & ((1 << numSetBits) - 1);
-    int tagBits = memAddr >> (numSetBits + numBlockBits);
-    
-    bool foundMatch = false;
-    int matchedWay = -1;
-
-    CacheUnit &currentCache = processorCaches[processorId];
+// Apply an access to the core's own cache. Returns true, with the request
+// to issue, if the access needs the bus.
+template <class Policy>
+static bool lookupOwnCache(CacheUnit &currentCache, const TraceRecord &traceEntry, BusRequestType &reqType)
+{
+    // Cache indexing fields were decoded when the trace was loaded
+    int setIndex = traceEntry.setIndex;
+    unsigned long long tagBits = traceEntry.tagBits;
+    int matchedWay = currentCache.findWay(setIndex, tagBits);
 
-    if (opType == 'R')
+    if (!traceEntry.isWrite)
     {
-        // Search for tag match
-        int searchIdx = 0;
-        while (searchIdx < associativity)
+        if (matchedWay != -1)
         {
-            if (coherenceTable[processorId][setIndex][searchIdx] != CoherenceState::INVALID && 
-                currentCache.tagArray[setIndex][searchIdx] == tagBits)
-            {
-                foundMatch = true;
-                matchedWay = searchIdx;
-                break;
-            }
-            searchIdx++;
+            // Update replacement state on hit
+            Policy::onHit(currentCache, setIndex, matchedWay);
+            return false;
         }
+        // Read miss - initiate bus read
+        reqType = BusRequestType::READ_SHARED;
+        return true;
+    }
 
-        if (foundMatch)
-        {
-            // Update LRU on hit
-            auto lruIt = find(currentCache.lruOrder[setIndex].begin(), currentCache.lruOrder[setIndex].end(), matchedWay);
-            if (lruIt != currentCache.lruOrder[setIndex].end())
-            {
-                currentCache.lruOrder[setIndex].erase(lruIt);
-            }
-            currentCache.lruOrder[setIndex].push_back(matchedWay);
-        }
-        else
+    if (matchedWay != -1)
+    {
+        CoherenceState &currentState = currentCache.statesOf(setIndex)[matchedWay];
+        Policy::onHit(currentCache, setIndex, matchedWay);
+
+        if (currentState == CoherenceState::EXCLUSIVE || currentState == CoherenceState::MODIFIED)
         {
-            // Read miss - initiate bus read
-            pendingRequests.push_back(BusTransaction{processorId, memAddr, BusRequestType::READ_SHARED});
-            processorCaches[processorId].isStalled = true;
+            // Can write locally
+            currentCache.dirtyOf(setIndex)[matchedWay] = true;
+            currentState = CoherenceState::MODIFIED;
+            return false;
         }
+        // Shared state - need upgrade
+        reqType = BusRequestType::UPGRADE_REQUEST;
+        return true;
     }
-    else
+
+    // Write miss
+    reqType = BusRequestType::READ_EXCLUSIVE;
+    return true;
+}
+
+template <class Policy>
+static void accessCache(const TraceRecord &traceEntry, int processorId)
+{
+    sim->operationCounter++;
+    
+    // Skip if pending operation exists
+    if (sim->pendingOperations[processorId] != -1)
     {
-        // Write operation - search for existing block
-        int searchIdx = 0;
-        while (searchIdx < associativity)
-        {
-            if (coherenceTable[processorId][setIndex][searchIdx] != CoherenceState::INVALID && 
-                currentCache.tagArray[setIndex][searchIdx] == tagBits)
-            {
-                foundMatch = true;
-                matchedWay = searchIdx;
-                break;
-            }
-            searchIdx++;
-        }
+        sim->totalCycles[processorId]++;
+        return;
+    }
 
-        if (foundMatch)
-        {
-            CoherenceState currentState = coherenceTable[processorId][setIndex][matchedWay];
-            
-            if (currentState == CoherenceState::EXCLUSIVE || currentState == CoherenceState::MODIFIED)
-            {
-                // Can write locally
-                auto lruIt = find(currentCache.lruOrder[setIndex].begin(), currentCache.lruOrder[setIndex].end(), matchedWay);
-                if (lruIt != currentCache.lruOrder[setIndex].end())
-                {
-                    currentCache.lruOrder[setIndex].erase(lruIt);
-                }
-                currentCache.lruOrder[setIndex].push_back(matchedWay);
-                currentCache.dirtyFlags[setIndex][matchedWay] = true;
-                
-                if (currentState == CoherenceState::EXCLUSIVE)
-                {
-                    coherenceTable[processorId][setIndex][matchedWay] = CoherenceState::MODIFIED;
-                }
-            }
-            else
-            {
-                // Shared state - need upgrade
-                pendingRequests.push_back(BusTransaction{processorId, memAddr, BusRequestType::UPGRADE_REQUEST});
-                auto lruIt = find(currentCache.lruOrder[setIndex].begin(), currentCache.lruOrder[setIndex].end(), matchedWay);
-                if (lruIt != currentCache.lruOrder[setIndex].end())
-                {
-                    currentCache.lruOrder[setIndex].erase(lruIt);
-                }
-                currentCache.lruOrder[setIndex].push_back(matchedWay);
-            }
-        }
-        else
-        {
-            // Write miss
-            pendingRequests.push_back(BusTransaction{processorId, memAddr, BusRequestType::READ_EXCLUSIVE});
-            processorCaches[processorId].isStalled = true;
-        }
+    // Wait for a queued request to win the bus
+    if (hasQueuedRequest(processorId))
+    {
+        return;
+    }
+
+    BusRequestType reqType;
+    if (lookupOwnCache<Policy>(sim->processorCaches[processorId], traceEntry, reqType))
+    {
+        issueBusRequest(processorId, traceEntry.address, reqType);
     }
 }
+
+void executeMemoryOperation(const TraceRecord &traceEntry, int processorId)
+{
+    PROFILE_SCOPE(HostPhase::MEMORY_OPERATION);
+    dispatchReplacement(sim->replacementPolicy, [&](auto policy) {
+        accessCache<decltype(policy)>(traceEntry, processorId);
+    });
+}
+
+bool applyLocalAccess(CacheUnit &cache, const TraceRecord &traceEntry, BusRequestType &reqType)
+{
+    return dispatchReplacement(sim->replacementPolicy, [&](auto policy) {
+        return lookupOwnCache<decltype(policy)>(cache, traceEntry, reqType);
+    });
+}
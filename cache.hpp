@@ -3,14 +3,41 @@
 
 #include <vector>
 #include <utility>
+#include <string>
+#include "main.hpp"
+#include "bus.hpp"
+
+// Display name, -r spelling and -r option parsing for replacement policies
+const char *replacementPolicyName(ReplacementPolicy policy);
+const char *replacementPolicyKey(ReplacementPolicy policy);
+bool parseReplacementPolicy(const std::string &name, ReplacementPolicy &policy);
+
+// Why a cache with this many ways cannot use the policy, or null if it can
+const char *geometryError(int ways, ReplacementPolicy policy);
+
+// Reset a freshly initialized cache's replacement state for a policy
+void initializeReplacement(CacheUnit &cache, ReplacementPolicy policy);
 
 // Execute a memory operation from trace for specified processor
-void executeMemoryOperation(std::pair<char, const char *> traceEntry, int processorId);
+void executeMemoryOperation(const TraceRecord &traceEntry, int processorId);
+
+// Apply an access to a cache exactly as executeMemoryOperation does when the
+// core is free, but leave the bus alone: returns true, with the request the
+// caller must issue, if the access needs the bus. Touches nothing outside
+// the cache, so different cores' caches can be updated concurrently.
+bool applyLocalAccess(CacheUnit &cache, const TraceRecord &traceEntry, BusRequestType &reqType);
+
+// True if the processor is stalled on an outstanding or queued bus
+// operation, i.e. each cycle executeMemoryOperation only counts a wait cycle
+bool isWaitingOnBus(int processorId);
+
+// Account for cycles in which a waiting processor only counts wait cycles
+void skipWaitingCycles(int processorId, int cycles);
 
 // Handle cache read miss - returns way index where data is loaded
-int processReadMiss(int processorId, int setIndex, int tagValue, bool &triggeredWriteback);
+int processReadMiss(int processorId, int setIndex, unsigned long long tagValue, bool &triggeredWriteback);
 
 // Handle cache write miss - returns way index where data is loaded
-int processWriteMiss(int processorId, int setIndex, int tagValue, bool &triggeredWriteback);
+int processWriteMiss(int processorId, int setIndex, unsigned long long tagValue, bool &triggeredWriteback);
 
 #endif // CACHE_HPP
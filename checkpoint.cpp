@@ -0,0 +1,478 @@
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include "main.hpp"
+#include "bus.hpp"
+#include "trace.hpp"
+#include "parallel.hpp"
+#include "state.hpp"
+#include "checkpoint.hpp"
+
+using namespace std;
+
+template <class T>
+static void writeValue(ostream &output, const T &value)
+{
+    output.write((const char *)&value, sizeof(T));
+}
+
+template <class T>
+static bool readValue(istream &input, T &value)
+{
+    return (bool)input.read((char *)&value, sizeof(T));
+}
+
+// Per-core vectors are written without a length; the core count is in the header
+template <class T>
+static void writeCoreVector(ostream &output, const vector<T> &values)
+{
+    output.write((const char *)values.data(), values.size() * sizeof(T));
+}
+
+template <class T>
+static bool readCoreVector(istream &input, vector<T> &values)
+{
+    return (bool)input.read((char *)values.data(), values.size() * sizeof(T));
+}
+
+static void writeCoreFlags(ostream &output, const vector<bool> &flags)
+{
+    for (bool flag : flags)
+    {
+        writeValue(output, (unsigned char)flag);
+    }
+}
+
+static bool readCoreFlags(istream &input, vector<bool> &flags)
+{
+    size_t flagIdx = 0;
+    while (flagIdx < flags.size())
+    {
+        unsigned char flag;
+        if (!readValue(input, flag))
+        {
+            return false;
+        }
+        flags[flagIdx] = flag != 0;
+        flagIdx++;
+    }
+    return true;
+}
+
+template <class T>
+static void writeQueue(ostream &output, const RingQueue<T> &queue)
+{
+    writeValue(output, (unsigned long long)queue.size());
+    size_t itemIdx = 0;
+    while (itemIdx < queue.size())
+    {
+        writeValue(output, queue.at(itemIdx));
+        itemIdx++;
+    }
+}
+
+template <class T>
+static bool readQueue(istream &input, RingQueue<T> &queue)
+{
+    unsigned long long itemCount;
+    if (!readValue(input, itemCount))
+    {
+        return false;
+    }
+    while (!queue.empty())
+    {
+        queue.pop_front();
+    }
+    while (itemCount > 0)
+    {
+        T item;
+        if (!readValue(input, item))
+        {
+            return false;
+        }
+        queue.push_back(item);
+        itemCount--;
+    }
+    return true;
+}
+
+void writeCheckpointHeader(ostream &output, const SimulatorConfig &config)
+{
+    output.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    writeValue(output, CHECKPOINT_VERSION);
+    writeValue(output, config.cores);
+    writeValue(output, config.setBits);
+    writeValue(output, config.ways);
+    writeValue(output, config.blockBits);
+    writeValue(output, (int)config.policy);
+    writeValue(output, (unsigned char)config.eventDriven);
+    writeValue(output, (unsigned char)config.functional);
+    writeValue(output, (unsigned char)config.snoopFilter);
+    writeValue(output, config.parallelThreads);
+    writeValue(output, config.quantumCycles);
+    writeValue(output, config.fastForward);
+    writeValue(output, config.region);
+    writeValue(output, config.samplePeriod);
+    writeValue(output, config.sampleWindow);
+    writeValue(output, config.sampleWarmup);
+    writeValue(output, config.llcWays);
+    writeValue(output, config.llcSetBits);
+    writeValue(output, config.llcBlockBits);
+    writeValue(output, (int)config.llcPolicy);
+    writeValue(output, (int)config.llcInclusion);
+    writeValue(output, config.llcHitCycles);
+}
+
+const char *readCheckpointHeader(istream &input, SimulatorConfig &config)
+{
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    unsigned int version;
+    if (!input.read(magic, sizeof(magic)) || memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0)
+    {
+        return "Not a checkpoint file.";
+    }
+    if (!readValue(input, version) || version != CHECKPOINT_VERSION)
+    {
+        return "Unsupported checkpoint version.";
+    }
+
+    int policy, llcPolicy, llcInclusion;
+    unsigned char eventDriven, functional, snoopFilter;
+    bool complete = readValue(input, config.cores) && readValue(input, config.setBits) &&
+                    readValue(input, config.ways) && readValue(input, config.blockBits) &&
+                    readValue(input, policy) && readValue(input, eventDriven) &&
+                    readValue(input, functional) && readValue(input, snoopFilter) &&
+                    readValue(input, config.parallelThreads) && readValue(input, config.quantumCycles) &&
+                    readValue(input, config.fastForward) && readValue(input, config.region) &&
+                    readValue(input, config.samplePeriod) && readValue(input, config.sampleWindow) &&
+                    readValue(input, config.sampleWarmup) && readValue(input, config.llcWays) &&
+                    readValue(input, config.llcSetBits) && readValue(input, config.llcBlockBits) &&
+                    readValue(input, llcPolicy) && readValue(input, llcInclusion) &&
+                    readValue(input, config.llcHitCycles);
+    if (!complete || policy < (int)ReplacementPolicy::LRU || policy > (int)ReplacementPolicy::RANDOM ||
+        llcPolicy < (int)ReplacementPolicy::LRU || llcPolicy > (int)ReplacementPolicy::RANDOM ||
+        llcInclusion < (int)LlcInclusion::INCLUSIVE || llcInclusion > (int)LlcInclusion::NINE)
+    {
+        return "Truncated or corrupt checkpoint.";
+    }
+    config.policy = (ReplacementPolicy)policy;
+    config.llcPolicy = (ReplacementPolicy)llcPolicy;
+    config.llcInclusion = (LlcInclusion)llcInclusion;
+    config.eventDriven = eventDriven != 0;
+    config.functional = functional != 0;
+    config.snoopFilter = snoopFilter != 0;
+    return nullptr;
+}
+
+static bool usesQuantumEngine()
+{
+    return sim->parallelThreads > 0 && !sim->functionalMode;
+}
+
+// Entries of a core's detailed region the engine has taken from its cursor.
+// The serial and functional engines advance on every retired access; the
+// parallel engine also holds the steps it ran ahead with. Sampled runs stop
+// between units, where every access the units used has retired.
+static unsigned long long regionPosition(int coreId)
+{
+    if (sim->samplePeriod > 0)
+    {
+        return sim->sampledAccesses[coreId];
+    }
+    unsigned long long position = sim->executedInstructions[coreId];
+    if (usesQuantumEngine())
+    {
+        const QuantumCore &core = sim->quantumCores[coreId];
+        position += core.hasExecuting + (core.steps.size() - core.replayed);
+    }
+    return position;
+}
+
+void writeSimulationState(ostream &output)
+{
+    int coreCount = sim->numCores;
+
+    // Progress and counters
+    writeValue(output, (unsigned char)sim->engineStarted);
+    writeValue(output, (unsigned char)sim->simulationActive);
+    writeValue(output, sim->currentCycle);
+    writeValue(output, sim->peakCycles);
+    writeValue(output, sim->busTransactionCount);
+    writeValue(output, sim->totalBusTraffic);
+    writeValue(output, sim->busBusyCycles);
+    writeValue(output, sim->snoopsAvoided);
+    writeValue(output, sim->runAheadConflicts);
+    writeValue(output, sim->quantumSlipCycles);
+    writeValue(output, sim->llcHits);
+    writeValue(output, sim->llcMisses);
+    writeValue(output, sim->llcBackInvalidations);
+    writeValue(output, sim->memoryWritebacks);
+    writeValue(output, sim->operationCounter);
+    writeCoreVector(output, sim->executedInstructions);
+    writeCoreVector(output, sim->totalCycles);
+    writeCoreVector(output, sim->readCount);
+    writeCoreVector(output, sim->writeCount);
+    writeCoreVector(output, sim->missCount);
+    writeCoreVector(output, sim->evictionCount);
+    writeCoreVector(output, sim->writebackCount);
+    writeCoreVector(output, sim->invalidationCount);
+    writeCoreVector(output, sim->trafficBytes);
+    writeCoreVector(output, sim->stalledCycles);
+    writeCoreVector(output, sim->warmedAccesses);
+    writeCoreVector(output, sim->sampledAccesses);
+    writeCoreFlags(output, sim->processorRunning);
+
+    // Caches: tags, MESI states, dirty bits and replacement state are one block
+    writeValue(output, sim->tagBytes);
+    int coreIdx = 0;
+    while (coreIdx < coreCount)
+    {
+        const CacheUnit &cache = sim->processorCaches[coreIdx];
+        writeValue(output, (unsigned char)cache.isStalled);
+        writeValue(output, cache.randomState);
+        output.write((const char *)cache.storage, (size_t)cache.totalSets * cache.setStride);
+        coreIdx++;
+    }
+    if (sim->llcWays > 0)
+    {
+        writeValue(output, sim->sharedCache.randomState);
+        output.write((const char *)sim->sharedCache.storage, (size_t)sim->sharedCache.totalSets * sim->sharedCache.setStride);
+    }
+
+    // Bus
+    writeValue(output, (unsigned char)sim->busOccupied);
+    writeValue(output, sim->busTickCounter);
+    writeValue(output, sim->snoopedCoreMask);
+    writeCoreVector(output, sim->pendingOperations);
+    writeCoreFlags(output, sim->requestQueued);
+    writeQueue(output, sim->pendingRequests);
+    writeQueue(output, sim->dataTransferQueue);
+    if (sim->snoopFilterEnabled)
+    {
+        sim->sharerDirectory.writeTo(output);
+    }
+
+    // Measured sampling units
+    writeValue(output, (unsigned long long)sim->samples.size());
+    for (const SampleUnit &unit : sim->samples)
+    {
+        writeValue(output, unit.accesses);
+        writeValue(output, unit.cycles);
+        writeValue(output, unit.misses);
+        writeValue(output, unit.busTraffic);
+        writeCoreVector(output, unit.coreAccesses);
+        writeCoreVector(output, unit.coreCycles);
+    }
+
+    if (!sim->engineStarted)
+    {
+        return;
+    }
+
+    // Trace positions, each with the next entry so a restore can tell
+    // whether it was given the same traces
+    coreIdx = 0;
+    while (coreIdx < coreCount)
+    {
+        const TraceCursor &cursor = usesQuantumEngine() ? sim->quantumCores[coreIdx].cursor : sim->traceCursor[coreIdx];
+        writeValue(output, sim->warmedAccesses[coreIdx] + regionPosition(coreIdx));
+        writeValue(output, (unsigned char)cursor.hasEntry());
+        writeValue(output, cursor.hasEntry() ? cursor.current() : (PackedTraceEntry)0);
+        coreIdx++;
+    }
+
+    if (usesQuantumEngine())
+    {
+        coreIdx = 0;
+        while (coreIdx < coreCount)
+        {
+            const QuantumCore &core = sim->quantumCores[coreIdx];
+            writeValue(output, (unsigned long long)core.steps.size());
+            output.write((const char *)core.steps.data(), core.steps.size() * sizeof(RunAheadStep));
+            writeValue(output, (unsigned long long)core.replayed);
+            writeValue(output, core.executing);
+            writeValue(output, (unsigned char)core.hasExecuting);
+            writeValue(output, (unsigned char)core.fetchedAll);
+            coreIdx++;
+        }
+    }
+}
+
+// Reopen a core's trace at the checkpoint's position
+static const char *restoreTraceCursor(istream &input, int coreId, TraceCursor &cursor)
+{
+    unsigned long long position;
+    unsigned char hadEntry;
+    PackedTraceEntry nextEntry;
+    if (!readValue(input, position) || !readValue(input, hadEntry) || !readValue(input, nextEntry))
+    {
+        return "Truncated or corrupt checkpoint.";
+    }
+    cursor = openTraceCursor(sim->coreTraces[coreId], sim->coreSources[coreId]);
+    unsigned long long warmed = sim->warmedAccesses[coreId];
+    if (position < warmed || !seekTraceCursor(cursor, position))
+    {
+        return "The traces do not match the checkpoint.";
+    }
+    limitCoreRegion(coreId, cursor, position - warmed);
+    if (cursor.hasEntry() != (hadEntry != 0) || (cursor.hasEntry() && cursor.current() != nextEntry))
+    {
+        return "The traces do not match the checkpoint.";
+    }
+    return nullptr;
+}
+
+const char *readSimulationState(istream &input)
+{
+    const char *corrupt = "Truncated or corrupt checkpoint.";
+    int coreCount = sim->numCores;
+
+    unsigned char engineStarted, simulationActive;
+    bool complete = readValue(input, engineStarted) && readValue(input, simulationActive) &&
+                    readValue(input, sim->currentCycle) && readValue(input, sim->peakCycles) &&
+                    readValue(input, sim->busTransactionCount) && readValue(input, sim->totalBusTraffic) &&
+                    readValue(input, sim->busBusyCycles) &&
+                    readValue(input, sim->snoopsAvoided) && readValue(input, sim->runAheadConflicts) &&
+                    readValue(input, sim->quantumSlipCycles) && readValue(input, sim->llcHits) &&
+                    readValue(input, sim->llcMisses) && readValue(input, sim->llcBackInvalidations) &&
+                    readValue(input, sim->memoryWritebacks) && readValue(input, sim->operationCounter) &&
+                    readCoreVector(input, sim->executedInstructions) && readCoreVector(input, sim->totalCycles) &&
+                    readCoreVector(input, sim->readCount) && readCoreVector(input, sim->writeCount) &&
+                    readCoreVector(input, sim->missCount) && readCoreVector(input, sim->evictionCount) &&
+                    readCoreVector(input, sim->writebackCount) && readCoreVector(input, sim->invalidationCount) &&
+                    readCoreVector(input, sim->trafficBytes) && readCoreVector(input, sim->stalledCycles) &&
+                    readCoreVector(input, sim->warmedAccesses) &&
+                    readCoreVector(input, sim->sampledAccesses) && readCoreFlags(input, sim->processorRunning);
+    if (!complete)
+    {
+        return corrupt;
+    }
+    sim->engineStarted = engineStarted != 0;
+    sim->simulationActive = simulationActive != 0;
+
+    // The caches are fresh, so they can take the checkpoint's tag width
+    int tagBytes;
+    if (!readValue(input, tagBytes) || (tagBytes != 4 && tagBytes != 8))
+    {
+        return corrupt;
+    }
+    if (tagBytes != sim->tagBytes)
+    {
+        initializeCaches(tagBytes);
+    }
+    int coreIdx = 0;
+    while (coreIdx < coreCount)
+    {
+        CacheUnit &cache = sim->processorCaches[coreIdx];
+        unsigned char isStalled;
+        if (!readValue(input, isStalled) || !readValue(input, cache.randomState) ||
+            !input.read((char *)cache.storage, (size_t)cache.totalSets * cache.setStride))
+        {
+            return corrupt;
+        }
+        cache.isStalled = isStalled != 0;
+        coreIdx++;
+    }
+    CacheUnit &llc = sim->sharedCache;
+    if (sim->llcWays > 0 &&
+        (!readValue(input, llc.randomState) || !input.read((char *)llc.storage, (size_t)llc.totalSets * llc.setStride)))
+    {
+        return corrupt;
+    }
+
+    unsigned char busOccupied;
+    complete = readValue(input, busOccupied) && readValue(input, sim->busTickCounter) &&
+               readValue(input, sim->snoopedCoreMask) && readCoreVector(input, sim->pendingOperations) &&
+               readCoreFlags(input, sim->requestQueued) && readQueue(input, sim->pendingRequests) &&
+               readQueue(input, sim->dataTransferQueue);
+    if (!complete || (sim->snoopFilterEnabled && !sim->sharerDirectory.readFrom(input)))
+    {
+        return corrupt;
+    }
+    sim->busOccupied = busOccupied != 0;
+
+    unsigned long long unitCount;
+    if (!readValue(input, unitCount))
+    {
+        return corrupt;
+    }
+    sim->samples.clear();
+    while (unitCount > 0)
+    {
+        SampleUnit unit;
+        unit.coreAccesses.resize(coreCount);
+        unit.coreCycles.resize(coreCount);
+        complete = readValue(input, unit.accesses) && readValue(input, unit.cycles) &&
+                   readValue(input, unit.misses) && readValue(input, unit.busTraffic) &&
+                   readCoreVector(input, unit.coreAccesses) && readCoreVector(input, unit.coreCycles);
+        if (!complete)
+        {
+            return corrupt;
+        }
+        sim->samples.push_back(unit);
+        unitCount--;
+    }
+
+    if (!sim->engineStarted)
+    {
+        return nullptr;
+    }
+
+    if (!usesQuantumEngine())
+    {
+        sim->traceCursor.resize(coreCount);
+        sim->currentOp.resize(coreCount);
+        coreIdx = 0;
+        while (coreIdx < coreCount)
+        {
+            const char *error = restoreTraceCursor(input, coreIdx, sim->traceCursor[coreIdx]);
+            if (error != nullptr)
+            {
+                return error;
+            }
+            if (sim->traceCursor[coreIdx].hasEntry())
+            {
+                sim->currentOp[coreIdx] = decodeTraceEntry(sim->traceCursor[coreIdx].current());
+            }
+            coreIdx++;
+        }
+        return nullptr;
+    }
+
+    sim->quantumCores.assign(coreCount, QuantumCore());
+    coreIdx = 0;
+    while (coreIdx < coreCount)
+    {
+        const char *error = restoreTraceCursor(input, coreIdx, sim->quantumCores[coreIdx].cursor);
+        if (error != nullptr)
+        {
+            return error;
+        }
+        coreIdx++;
+    }
+    coreIdx = 0;
+    while (coreIdx < coreCount)
+    {
+        QuantumCore &core = sim->quantumCores[coreIdx];
+        unsigned long long stepCount, replayed;
+        unsigned char hasExecuting, fetchedAll;
+        if (!readValue(input, stepCount) || stepCount > (unsigned long long)sim->quantumCycles)
+        {
+            return corrupt;
+        }
+        core.steps.reserve(sim->quantumCycles);
+        core.steps.resize(stepCount);
+        complete = input.read((char *)core.steps.data(), stepCount * sizeof(RunAheadStep)) &&
+                   readValue(input, replayed) && readValue(input, core.executing) &&
+                   readValue(input, hasExecuting) && readValue(input, fetchedAll);
+        if (!complete || replayed > stepCount)
+        {
+            return corrupt;
+        }
+        core.replayed = replayed;
+        core.hasExecuting = hasExecuting != 0;
+        core.fetchedAll = fetchedAll != 0;
+        coreIdx++;
+    }
+    return nullptr;
+}
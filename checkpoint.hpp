@@ -0,0 +1,36 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <iostream>
+#include "simulator.hpp"
+
+using namespace std;
+
+// Checkpoint file layout (native byte order):
+//   magic, version
+//   SimulatorConfig fields
+//   engine progress and counters
+//   cache tag width; per core: cache metadata block, trace position
+//   shared LLC metadata block (with an LLC only)
+//   bus queues and per-core bus state, sharer directory
+//   measured sampling units
+//   parallel engine run-ahead steps (parallel engine only)
+// Traces are not included; a checkpoint is resumed on the same traces.
+const char CHECKPOINT_MAGIC[8] = {'L', '1', 'S', 'C', 'H', 'K', 'P', 'T'};
+const unsigned int CHECKPOINT_VERSION = 5;
+
+// Write the magic, version and configuration
+void writeCheckpointHeader(ostream &output, const SimulatorConfig &config);
+
+// Read them back; returns why the file is not a usable checkpoint, or null
+const char *readCheckpointHeader(istream &input, SimulatorConfig &config);
+
+// Write everything the bound simulation has done so far
+void writeSimulationState(ostream &output);
+
+// Replace the bound simulation's progress with a checkpoint's. The
+// simulation must be freshly configured from the checkpoint's header and
+// hold the same traces; returns why the checkpoint does not fit, or null.
+const char *readSimulationState(istream &input);
+
+#endif // CHECKPOINT_HPP
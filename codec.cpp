@@ -0,0 +1,397 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+#include <sys/stat.h>
+#include "main.hpp"
+#include "trace.hpp"
+#include "codec.hpp"
+
+using namespace std;
+
+static inline void writeVarint(vector<unsigned char> &out, unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((unsigned char)value);
+}
+
+// Read a LEB128 varint ending before readEnd; false if the stream ends first
+// or the varint is longer than 64 bits
+static inline bool readVarint(const unsigned char *&readPtr, const unsigned char *readEnd, unsigned long long &value)
+{
+    // Single-byte fast path covers most strided deltas
+    if (readPtr < readEnd && *readPtr < 0x80)
+    {
+        value = *readPtr++;
+        return true;
+    }
+
+    value = 0;
+    int shift = 0;
+    while (readPtr < readEnd && shift < 64)
+    {
+        unsigned char byte = *readPtr++;
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        if (byte < 0x80)
+        {
+            return true;
+        }
+        shift += 7;
+    }
+    return false;
+}
+
+// Walk one core's stream without expanding it: every run must be non-empty
+// and every varint complete, and the runs must hold exactly recordCount
+// records and end where the stream does
+static bool streamIsWellFormed(const unsigned char *data, size_t byteCount, unsigned long long recordCount)
+{
+    const unsigned char *readPtr = data;
+    const unsigned char *readEnd = data + byteCount;
+    unsigned long long remainingRecords = recordCount;
+    while (remainingRecords > 0)
+    {
+        unsigned long long runHeader;
+        if (!readVarint(readPtr, readEnd, runHeader) || (runHeader >> 1) == 0 || (runHeader >> 1) > remainingRecords)
+        {
+            return false;
+        }
+        unsigned long long runRemaining = runHeader >> 1;
+        remainingRecords -= runRemaining;
+        while (runRemaining > 0)
+        {
+            unsigned long long zigzag;
+            if (!readVarint(readPtr, readEnd, zigzag))
+            {
+                return false;
+            }
+            runRemaining--;
+        }
+    }
+    return readPtr == readEnd;
+}
+
+// Expands one core's compressed stream a block at a time into a fixed window
+class CompressedTraceDecoder : public TraceSource
+{
+public:
+    CompressedTraceDecoder(const unsigned char *data, size_t byteCount, unsigned long long recordCount)
+        : readPtr(data), readEnd(data + byteCount), remainingRecords(recordCount),
+          previousAddress(0), runRemaining(0), runFlag(0)
+    {
+    }
+
+    bool nextWindow(const PackedTraceEntry *&begin, const PackedTraceEntry *&end) override
+    {
+        size_t produced = decodeBlock(window, CODEC_BLOCK_ENTRIES);
+        begin = window;
+        end = window + produced;
+        return produced > 0;
+    }
+
+    // Decode up to capacity records into out; returns the number produced
+    size_t decodeBlock(PackedTraceEntry *out, size_t capacity)
+    {
+        size_t produced = 0;
+        while (produced < capacity && remainingRecords > 0)
+        {
+            if (runRemaining == 0)
+            {
+                unsigned long long runHeader;
+                if (!readVarint(readPtr, readEnd, runHeader) || (runHeader >> 1) == 0)
+                {
+                    return abortCorrupt(produced);
+                }
+                runRemaining = runHeader >> 1;
+                runFlag = (runHeader & 1) ? TRACE_WRITE_FLAG : 0;
+            }
+
+            size_t take = capacity - produced;
+            if (take > runRemaining)
+            {
+                take = runRemaining;
+            }
+            if (take > remainingRecords)
+            {
+                take = remainingRecords;
+            }
+
+            size_t takeIdx = 0;
+            while (takeIdx < take)
+            {
+                unsigned long long zigzag;
+                if (!readVarint(readPtr, readEnd, zigzag))
+                {
+                    return abortCorrupt(produced);
+                }
+                previousAddress += (zigzag >> 1) ^ (0 - (zigzag & 1));
+                out[produced++] = (previousAddress & ~TRACE_WRITE_FLAG) | runFlag;
+                takeIdx++;
+            }
+            runRemaining -= take;
+            remainingRecords -= take;
+        }
+        return produced;
+    }
+
+private:
+    // mapCompressedTrace checks every stream before decoding it, so this
+    // only stops a decoder given unchecked bytes from running off the end
+    size_t abortCorrupt(size_t produced)
+    {
+        cerr << "Error: Compressed trace stream is corrupt; " << remainingRecords
+             << " records could not be decoded" << endl;
+        remainingRecords = 0;
+        return produced;
+    }
+
+    const unsigned char *readPtr;
+    const unsigned char *readEnd;
+    unsigned long long remainingRecords;
+    unsigned long long previousAddress;
+    unsigned long long runRemaining;
+    PackedTraceEntry runFlag;
+    PackedTraceEntry window[CODEC_BLOCK_ENTRIES];
+};
+
+void encodeTrace(const PackedTraceEntry *entries, size_t count, vector<unsigned char> &out)
+{
+    unsigned long long previousAddress = 0;
+    size_t runStart = 0;
+    while (runStart < count)
+    {
+        // Extend the run while the operation type stays the same
+        PackedTraceEntry runFlag = entries[runStart] & TRACE_WRITE_FLAG;
+        size_t runEnd = runStart + 1;
+        while (runEnd < count && (entries[runEnd] & TRACE_WRITE_FLAG) == runFlag)
+        {
+            runEnd++;
+        }
+        writeVarint(out, ((unsigned long long)(runEnd - runStart) << 1) | (runFlag ? 1 : 0));
+
+        size_t entryIdx = runStart;
+        while (entryIdx < runEnd)
+        {
+            unsigned long long address = entries[entryIdx] & ~TRACE_WRITE_FLAG;
+            long long delta = (long long)(address - previousAddress);
+            writeVarint(out, ((unsigned long long)delta << 1) ^ (unsigned long long)(delta >> 63));
+            previousAddress = address;
+            entryIdx++;
+        }
+        runStart = runEnd;
+    }
+}
+
+static unsigned long long fileSizeOf(const string &path)
+{
+    struct stat fileInfo;
+    return stat(path.c_str(), &fileInfo) == 0 ? fileInfo.st_size : 0;
+}
+
+bool compressTraces(const string &source, const string &outputPath)
+{
+    TraceFileKind sourceKind = detectTraceFile(source);
+    unsigned long long inputBytes = 0;
+    if (sourceKind == TraceFileKind::COMPRESSED)
+    {
+        cerr << "Error: " << source << " is already compressed" << endl;
+        return false;
+    }
+    else if (sourceKind == TraceFileKind::BINARY)
+    {
+        if (!mapBinaryTrace(source))
+        {
+            return false;
+        }
+        inputBytes = fileSizeOf(source);
+    }
+    else
+    {
+        if (!loadProcessorTraces(source))
+        {
+            return false;
+        }
+        int procIdx = 0;
+        while (procIdx < traceCoreCount)
+        {
+            inputBytes += fileSizeOf(source + "_proc" + to_string(procIdx) + ".trace");
+            procIdx++;
+        }
+    }
+
+    vector<vector<unsigned char>> encoded(traceCoreCount);
+    unsigned long long totalRecords = 0;
+    unsigned long long totalEncoded = 0;
+    int coreIdx = 0;
+    while (coreIdx < traceCoreCount)
+    {
+        encodeTrace(loadedTraces[coreIdx].entries, loadedTraces[coreIdx].length, encoded[coreIdx]);
+        totalRecords += loadedTraces[coreIdx].length;
+        totalEncoded += encoded[coreIdx].size();
+        coreIdx++;
+    }
+
+    // Decode everything once: timed pass for throughput, then a round-trip check
+    unsigned long long checksum = 0;
+    auto decodeStart = chrono::steady_clock::now();
+    coreIdx = 0;
+    while (coreIdx < traceCoreCount)
+    {
+        CompressedTraceDecoder decoder(encoded[coreIdx].data(), encoded[coreIdx].size(), loadedTraces[coreIdx].length);
+        const PackedTraceEntry *begin;
+        const PackedTraceEntry *end;
+        while (decoder.nextWindow(begin, end))
+        {
+            while (begin != end)
+            {
+                checksum += *begin++;
+            }
+        }
+        coreIdx++;
+    }
+    double decodeSeconds = chrono::duration<double>(chrono::steady_clock::now() - decodeStart).count();
+
+    coreIdx = 0;
+    while (coreIdx < traceCoreCount)
+    {
+        CompressedTraceDecoder decoder(encoded[coreIdx].data(), encoded[coreIdx].size(), loadedTraces[coreIdx].length);
+        const PackedTraceEntry *begin;
+        const PackedTraceEntry *end;
+        size_t verified = 0;
+        while (decoder.nextWindow(begin, end))
+        {
+            size_t windowLength = end - begin;
+            if (verified + windowLength > loadedTraces[coreIdx].length ||
+                memcmp(begin, loadedTraces[coreIdx].entries + verified, windowLength * sizeof(PackedTraceEntry)) != 0)
+            {
+                break;
+            }
+            verified += windowLength;
+        }
+        if (verified != loadedTraces[coreIdx].length)
+        {
+            cerr << "Error: Round-trip check failed for core " << coreIdx << endl;
+            return false;
+        }
+        coreIdx++;
+    }
+
+    ofstream outputFile(outputPath, ios::binary | ios::trunc);
+    if (!outputFile.is_open())
+    {
+        cerr << "Error: Could not open output file " << outputPath << endl;
+        return false;
+    }
+
+    TraceFileHeader header;
+    memcpy(header.magic, COMPRESSED_TRACE_MAGIC, sizeof(COMPRESSED_TRACE_MAGIC));
+    header.version = COMPRESSED_TRACE_VERSION;
+    header.coreCount = traceCoreCount;
+    outputFile.write((const char *)&header, sizeof(header));
+
+    coreIdx = 0;
+    while (coreIdx < traceCoreCount)
+    {
+        unsigned long long counts[2] = {loadedTraces[coreIdx].length, encoded[coreIdx].size()};
+        outputFile.write((const char *)counts, sizeof(counts));
+        coreIdx++;
+    }
+    coreIdx = 0;
+    while (coreIdx < traceCoreCount)
+    {
+        outputFile.write((const char *)encoded[coreIdx].data(), encoded[coreIdx].size());
+        coreIdx++;
+    }
+    if (!outputFile.good())
+    {
+        cerr << "Error: Failed writing compressed trace " << outputPath << endl;
+        return false;
+    }
+
+    unsigned long long rawBytes = totalRecords * sizeof(PackedTraceEntry);
+    cout << "Wrote compressed trace " << outputPath << "\n";
+    cout << "  Records:              " << setw(14) << totalRecords << "\n";
+    cout << "  Input size:           " << setw(14) << inputBytes << " bytes\n";
+    cout << "  Packed binary size:   " << setw(14) << rawBytes << " bytes\n";
+    cout << "  Compressed size:      " << setw(14) << totalEncoded << " bytes\n";
+    cout << fixed << setprecision(2);
+    cout << "  Bytes per record:     " << setw(14) << (totalRecords ? (double)totalEncoded / totalRecords : 0.0) << "\n";
+    cout << "  Ratio vs input:       " << setw(13) << (totalEncoded ? (double)inputBytes / totalEncoded : 0.0) << "x\n";
+    cout << "  Ratio vs packed:      " << setw(13) << (totalEncoded ? (double)rawBytes / totalEncoded : 0.0) << "x\n";
+    cout << "  Decode throughput:    " << setw(14) << (decodeSeconds > 0 ? totalRecords / decodeSeconds / 1e6 : 0.0)
+         << " M records/s (checksum " << hex << checksum << dec << ")\n";
+    return true;
+}
+
+bool mapCompressedTrace(const string &path)
+{
+    const char *base;
+    size_t fileSize;
+    if (!mapTraceFile(path, base, fileSize))
+    {
+        return false;
+    }
+
+    const TraceFileHeader *header = (const TraceFileHeader *)base;
+    size_t offset = sizeof(TraceFileHeader) + traceCoreCount * 2 * sizeof(unsigned long long);
+    if (memcmp(header->magic, COMPRESSED_TRACE_MAGIC, sizeof(COMPRESSED_TRACE_MAGIC)) != 0 ||
+        header->version != COMPRESSED_TRACE_VERSION || header->coreCount != (unsigned int)traceCoreCount ||
+        fileSize < offset)
+    {
+        cerr << "Error: " << path << " is not a version " << COMPRESSED_TRACE_VERSION
+             << " compressed trace for " << traceCoreCount << " cores" << endl;
+        releaseTraces();
+        return false;
+    }
+
+    // Per-core (recordCount, byteCount) pairs must tile the rest of the file
+    const unsigned long long *counts = (const unsigned long long *)(header + 1);
+    unsigned long long payloadBytes = 0;
+    bool sizeValid = true;
+    int coreIdx = 0;
+    while (coreIdx < traceCoreCount)
+    {
+        sizeValid = sizeValid && counts[2 * coreIdx + 1] <= fileSize;
+        payloadBytes += counts[2 * coreIdx + 1];
+        coreIdx++;
+    }
+    if (!sizeValid || payloadBytes != fileSize - offset)
+    {
+        cerr << "Error: Compressed trace " << path << " size does not match its header" << endl;
+        releaseTraces();
+        return false;
+    }
+
+    // Check every stream up front: a corrupt one is an error before the run,
+    // not a truncated trace discovered halfway through it
+    size_t streamOffset = offset;
+    coreIdx = 0;
+    while (coreIdx < traceCoreCount)
+    {
+        if (!streamIsWellFormed((const unsigned char *)base + streamOffset, counts[2 * coreIdx + 1], counts[2 * coreIdx]))
+        {
+            cerr << "Error: Compressed trace " << path << " is corrupt in the stream of core " << coreIdx << endl;
+            releaseTraces();
+            return false;
+        }
+        streamOffset += counts[2 * coreIdx + 1];
+        coreIdx++;
+    }
+
+    coreIdx = 0;
+    while (coreIdx < traceCoreCount)
+    {
+        const unsigned char *stream = (const unsigned char *)base + offset;
+        installTraceSource(coreIdx, new CompressedTraceDecoder(stream, counts[2 * coreIdx + 1], counts[2 * coreIdx]));
+        offset += counts[2 * coreIdx + 1];
+        coreIdx++;
+    }
+    return true;
+}
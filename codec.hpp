@@ -0,0 +1,33 @@
+#ifndef CODEC_HPP
+#define CODEC_HPP
+
+#include <string>
+#include <vector>
+#include "main.hpp"
+
+using namespace std;
+
+// Compressed trace container layout (native byte order):
+//   TraceFileHeader with COMPRESSED_TRACE_MAGIC
+//   per core: unsigned long long recordCount, unsigned long long byteCount
+//   encoded byte streams, core 0 first, then core 1, ...
+//
+// Each core's stream is a sequence of runs of one operation type:
+//   varint  (runLength << 1) | isWrite
+//   varint  zigzag(address - previousAddress), repeated runLength times
+// Varints are LEB128; previousAddress starts at 0 for every core.
+
+// Number of records a decoder expands per window refill
+const size_t CODEC_BLOCK_ENTRIES = 4096;
+
+// Append the encoding of count entries to out
+void encodeTrace(const PackedTraceEntry *entries, size_t count, vector<unsigned char> &out);
+
+// Encode the traces named by source (text prefix or binary trace) into a
+// compressed trace file and report compression ratio and decode throughput
+bool compressTraces(const string &source, const string &outputPath);
+
+// Map a compressed trace and install a block decoder for each core
+bool mapCompressedTrace(const string &path);
+
+#endif // CODEC_HPP
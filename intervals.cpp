@@ -0,0 +1,164 @@
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "main.hpp"
+#include "simulator.hpp"
+#include "intervals.hpp"
+
+using namespace std;
+
+static const size_t STATS_BUFFER_BYTES = 1 << 20;
+
+static const char *const intervalColumns[] = {
+    "record", "cycle", "core", "instructions", "reads", "writes", "misses", "evictions", "writebacks",
+    "invalidations", "traffic_bytes", "stall_cycles", "bus_transactions", "bus_traffic", "bus_utilization"
+};
+
+// Counters of a core, or of all cores, between two records
+static CoreStats coreDelta(const CoreStats &now, const CoreStats &then)
+{
+    CoreStats delta;
+    delta.instructions = now.instructions - then.instructions;
+    delta.reads = now.reads - then.reads;
+    delta.writes = now.writes - then.writes;
+    delta.misses = now.misses - then.misses;
+    delta.evictions = now.evictions - then.evictions;
+    delta.writebacks = now.writebacks - then.writebacks;
+    delta.invalidations = now.invalidations - then.invalidations;
+    delta.dataTraffic = now.dataTraffic - then.dataTraffic;
+    delta.executionCycles = now.executionCycles - then.executionCycles;
+    delta.stallCycles = now.stallCycles - then.stallCycles;
+    return delta;
+}
+
+static void addCore(CoreStats &total, const CoreStats &core)
+{
+    total.instructions += core.instructions;
+    total.reads += core.reads;
+    total.writes += core.writes;
+    total.misses += core.misses;
+    total.evictions += core.evictions;
+    total.writebacks += core.writebacks;
+    total.invalidations += core.invalidations;
+    total.dataTraffic += core.dataTraffic;
+    total.executionCycles += core.executionCycles;
+    total.stallCycles += core.stallCycles;
+}
+
+// Stats of a simulation that has not run, to take totals against
+static SimulatorStats emptyStats(size_t coreCount)
+{
+    SimulatorStats empty = SimulatorStats();
+    empty.cores.assign(coreCount, CoreStats());
+    return empty;
+}
+
+bool IntervalStatsWriter::open(const string &path, const SimulatorConfig &config, const SimulatorStats &start)
+{
+    // The buffer has to be in place before the file opens
+    buffer.resize(STATS_BUFFER_BYTES);
+    output.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    output.open(path, ios::trunc);
+    if (!output.is_open())
+    {
+        return false;
+    }
+    asJson = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    untimed = config.functional;
+    previous = start;
+
+    if (!asJson)
+    {
+        const size_t columnCount = sizeof(intervalColumns) / sizeof(intervalColumns[0]);
+        size_t colIdx = 0;
+        while (colIdx < columnCount)
+        {
+            output << (colIdx ? "," : "") << intervalColumns[colIdx];
+            colIdx++;
+        }
+        output << "\n";
+    }
+    return true;
+}
+
+void IntervalStatsWriter::writeInterval(const SimulatorStats &stats)
+{
+    if (stats.clock == previous.clock)
+    {
+        return;
+    }
+    writeRecord("interval", stats, previous);
+    previous = stats;
+}
+
+bool IntervalStatsWriter::writeSummary(const SimulatorStats &stats)
+{
+    writeRecord("final", stats, emptyStats(stats.cores.size()));
+    output.flush();
+    return output.good();
+}
+
+void IntervalStatsWriter::writeRecord(const char *record, const SimulatorStats &stats, const SimulatorStats &since)
+{
+    size_t coreCount = stats.cores.size();
+    vector<CoreStats> rows(coreCount + 1, CoreStats());
+    size_t coreIdx = 0;
+    while (coreIdx < coreCount)
+    {
+        rows[coreIdx] = coreDelta(stats.cores[coreIdx], since.cores[coreIdx]);
+        if (untimed)
+        {
+            rows[coreIdx].stallCycles = 0;
+        }
+        addCore(rows[coreCount], rows[coreIdx]);
+        coreIdx++;
+    }
+
+    long long cycles = stats.clock - since.clock;
+    long long busTransactions = stats.busTransactions - since.busTransactions;
+    long long busTraffic = stats.busTraffic - since.busTraffic;
+    double busUtilization = !untimed && cycles > 0 ? (double)(stats.busBusyCycles - since.busBusyCycles) / cycles : 0.0;
+
+    if (asJson)
+    {
+        output << "{\"record\": \"" << record << "\", \"cycle\": " << stats.clock;
+        if (!untimed && stats.finished)
+        {
+            output << ", \"simulation_cycles\": " << stats.timing.simulationCycles
+                   << ", \"max_exec_cycles\": " << stats.timing.peakCycles;
+        }
+        output << ", \"bus_transactions\": " << busTransactions << ", \"bus_traffic\": " << busTraffic
+               << ", \"bus_utilization\": " << fixed << setprecision(6) << busUtilization << ", \"cores\": [";
+    }
+
+    size_t rowIdx = 0;
+    while (rowIdx <= coreCount)
+    {
+        const CoreStats &row = rows[rowIdx];
+        string coreLabel = rowIdx < coreCount ? to_string(rowIdx) : "all";
+        if (asJson)
+        {
+            output << (rowIdx ? ", " : "") << "{\"core\": " << (rowIdx < coreCount ? coreLabel : "\"all\"")
+                   << ", \"instructions\": " << row.instructions << ", \"reads\": " << row.reads
+                   << ", \"writes\": " << row.writes << ", \"misses\": " << row.misses
+                   << ", \"evictions\": " << row.evictions << ", \"writebacks\": " << row.writebacks
+                   << ", \"invalidations\": " << row.invalidations << ", \"traffic_bytes\": " << row.dataTraffic
+                   << ", \"stall_cycles\": " << row.stallCycles << "}";
+        }
+        else
+        {
+            output << record << "," << stats.clock << "," << coreLabel << "," << row.instructions << ","
+                   << row.reads << "," << row.writes << "," << row.misses << "," << row.evictions << ","
+                   << row.writebacks << "," << row.invalidations << "," << row.dataTraffic << ","
+                   << row.stallCycles << "," << busTransactions << "," << busTraffic << ","
+                   << fixed << setprecision(6) << busUtilization << "\n";
+        }
+        rowIdx++;
+    }
+
+    if (asJson)
+    {
+        output << "]}\n";
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef INTERVALS_HPP
+#define INTERVALS_HPP
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "simulator.hpp"
+
+using namespace std;
+
+// Interval statistics stream (--stats-interval). Every record holds one
+// row per core and an "all" row with their sums:
+//   CSV: record,cycle,core,instructions,...,bus_utilization per row
+//   JSON lines (.json file): one object per record with a "cores" array
+// Interval records count the events since the previous record; the final
+// record holds the totals of the run. Bus columns cover the whole bus.
+class IntervalStatsWriter
+{
+public:
+    // Open path for a simulation configured with config and currently at
+    // start; false if the file cannot be created
+    bool open(const string &path, const SimulatorConfig &config, const SimulatorStats &start);
+
+    // Record the events since the previous record; nothing if no cycle passed
+    void writeInterval(const SimulatorStats &stats);
+
+    // Record the run's totals; false if anything failed to write
+    bool writeSummary(const SimulatorStats &stats);
+
+private:
+    void writeRecord(const char *record, const SimulatorStats &stats, const SimulatorStats &since);
+
+    ofstream output;
+    vector<char> buffer;        // Records reach the file in large writes
+    bool asJson;
+    bool untimed;               // Functional mode: no stalls or bus cycles
+    SimulatorStats previous;
+};
+
+#endif // INTERVALS_HPP
@@ -0,0 +1,251 @@
+#include <string>
+#include <utility>
+#include "main.hpp"
+#include "cache.hpp"
+#include "llc.hpp"
+#include "replacement.hpp"
+#include "snoop.hpp"
+#include "state.hpp"
+
+using namespace std;
+
+const char *llcInclusionName(LlcInclusion inclusion)
+{
+    switch (inclusion)
+    {
+    case LlcInclusion::EXCLUSIVE:
+        return "Exclusive";
+    case LlcInclusion::NINE:
+        return "Non-inclusive (NINE)";
+    case LlcInclusion::INCLUSIVE:
+    default:
+        return "Inclusive";
+    }
+}
+
+static const pair<const char *, LlcInclusion> inclusionKeys[] = {
+    {"inclusive", LlcInclusion::INCLUSIVE}, {"exclusive", LlcInclusion::EXCLUSIVE}, {"nine", LlcInclusion::NINE}
+};
+
+bool parseLlcInclusion(const string &name, LlcInclusion &inclusion)
+{
+    for (const auto &entry : inclusionKeys)
+    {
+        if (name == entry.first)
+        {
+            inclusion = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+void initializeLlc()
+{
+    if (sim->llcWays == 0)
+    {
+        return;
+    }
+    sim->sharedCache.initialize(sim->llcSetBits, sim->llcBlockBits, sim->llcWays, 8, MAX_CORES + 1);
+    initializeReplacement(sim->sharedCache, sim->llcPolicy);
+}
+
+static int llcSetOf(unsigned long long address)
+{
+    return (address >> sim->llcBlockBits) & ((1ULL << sim->llcSetBits) - 1);
+}
+
+static unsigned long long llcTagOf(unsigned long long address)
+{
+    return address >> (sim->llcSetBits + sim->llcBlockBits);
+}
+
+// L1 set index and tag of the block at address
+static int l1SetOf(unsigned long long address)
+{
+    return (address >> sim->numBlockBits) & ((1ULL << sim->numSetBits) - 1);
+}
+
+static unsigned long long l1TagOf(unsigned long long address)
+{
+    return address >> (sim->numSetBits + sim->numBlockBits);
+}
+
+// True if an L1 other than processorId's holds the block at address
+static bool heldByPeer(int processorId, unsigned long long address)
+{
+    int setIndex = l1SetOf(address);
+    unsigned long long tagBits = l1TagOf(address);
+    if (sim->snoopFilterEnabled)
+    {
+        return (sim->sharerDirectory.sharers(setIndex, tagBits) & ~(1ULL << processorId)) != 0;
+    }
+    int coreIdx = 0;
+    while (coreIdx < sim->numCores)
+    {
+        if (coreIdx != processorId && sim->processorCaches[coreIdx].findWay(setIndex, tagBits) != -1)
+        {
+            return true;
+        }
+        coreIdx++;
+    }
+    return false;
+}
+
+// Inclusion: invalidate every L1 copy of the L1 blocks an evicted LLC block
+// covers. Returns true if one of them was modified; its data goes to memory
+// with the LLC block.
+static bool backInvalidate(unsigned long long blockAddr)
+{
+    bool modified = false;
+    unsigned long long blockCount = 1ULL << (sim->llcBlockBits - sim->numBlockBits);
+    unsigned long long blockIdx = 0;
+    while (blockIdx < blockCount)
+    {
+        unsigned long long address = blockAddr + (blockIdx << sim->numBlockBits);
+        int setIndex = l1SetOf(address);
+        unsigned long long tagBits = l1TagOf(address);
+        unsigned long long holders = sim->snoopFilterEnabled ? sim->sharerDirectory.sharers(setIndex, tagBits)
+                                                             : sim->allCoresMask;
+        while (holders != 0)
+        {
+            int coreIdx = __builtin_ctzll(holders);
+            holders &= holders - 1;
+            CoherenceState *states = sim->processorCaches[coreIdx].statesOf(setIndex);
+            bool held = false;
+            sim->processorCaches[coreIdx].forEachMatchingWay(setIndex, tagBits, [&](int wayIdx) {
+                modified = modified || states[wayIdx] == CoherenceState::MODIFIED;
+                states[wayIdx] = CoherenceState::INVALID;
+                held = true;
+            });
+            if (held)
+            {
+                sim->llcBackInvalidations++;
+                sim->snoopedCoreMask |= 1ULL << coreIdx;
+                if (sim->snoopFilterEnabled)
+                {
+                    sim->sharerDirectory.removeSharer(coreIdx, setIndex, tagBits);
+                }
+            }
+        }
+        blockIdx++;
+    }
+    return modified;
+}
+
+// Put the block at address in the LLC, or mark the copy there dirty. The
+// replacement victim goes to memory if dirty and, under inclusion, out of
+// every L1.
+static void insertIntoLlc(unsigned long long address, bool dirty)
+{
+    CacheUnit &llc = sim->sharedCache;
+    int setIndex = llcSetOf(address);
+    unsigned long long tagBits = llcTagOf(address);
+    int wayIdx = llc.findWay(setIndex, tagBits);
+    if (wayIdx != -1)
+    {
+        llc.dirtyOf(setIndex)[wayIdx] |= dirty;
+        return;
+    }
+
+    dispatchReplacement(sim->llcPolicy, [&](auto policy) {
+        wayIdx = llc.findState(setIndex, CoherenceState::INVALID);
+        if (wayIdx == -1)
+        {
+            wayIdx = decltype(policy)::victim(llc, setIndex);
+            bool victimDirty = llc.dirtyOf(setIndex)[wayIdx] != 0;
+            if (sim->llcInclusion == LlcInclusion::INCLUSIVE)
+            {
+                unsigned long long victimAddr = (llc.tagAt(setIndex, wayIdx) << (sim->llcSetBits + sim->llcBlockBits)) |
+                                                ((unsigned long long)setIndex << sim->llcBlockBits);
+                victimDirty = backInvalidate(victimAddr) || victimDirty;
+            }
+            if (victimDirty)
+            {
+                sim->memoryWritebacks++;
+            }
+        }
+        decltype(policy)::onFill(llc, setIndex, wayIdx);
+    });
+    llc.setTag(setIndex, wayIdx, tagBits);
+    llc.statesOf(setIndex)[wayIdx] = CoherenceState::EXCLUSIVE;
+    llc.dirtyOf(setIndex)[wayIdx] = dirty;
+}
+
+int fetchFromLlc(unsigned long long address)
+{
+    if (sim->llcWays == 0)
+    {
+        return MEMORY_CYCLES;
+    }
+    CacheUnit &llc = sim->sharedCache;
+    int setIndex = llcSetOf(address);
+    int wayIdx = llc.findWay(setIndex, llcTagOf(address));
+    if (wayIdx == -1)
+    {
+        sim->llcMisses++;
+        if (sim->llcInclusion != LlcInclusion::EXCLUSIVE)
+        {
+            insertIntoLlc(address, false);
+        }
+        return MEMORY_CYCLES;
+    }
+
+    sim->llcHits++;
+    if (sim->llcInclusion == LlcInclusion::EXCLUSIVE)
+    {
+        // The block moves up into the L1; a dirty copy is written to memory
+        // on the way, as the L1 takes it clean
+        if (llc.dirtyOf(setIndex)[wayIdx])
+        {
+            sim->memoryWritebacks++;
+        }
+        llc.statesOf(setIndex)[wayIdx] = CoherenceState::INVALID;
+    }
+    else
+    {
+        dispatchReplacement(sim->llcPolicy, [&](auto policy) {
+            decltype(policy)::onHit(llc, setIndex, wayIdx);
+        });
+    }
+    return sim->llcHitCycles;
+}
+
+bool llcTakesWriteback(int processorId, unsigned long long address, bool evicting)
+{
+    if (sim->llcWays == 0)
+    {
+        return false;
+    }
+    if (sim->llcInclusion == LlcInclusion::EXCLUSIVE)
+    {
+        // Only blocks leaving the last L1 that holds them
+        return evicting && !heldByPeer(processorId, address);
+    }
+    return sim->sharedCache.findWay(llcSetOf(address), llcTagOf(address)) != -1;
+}
+
+int writebackCycles(bool intoLlc)
+{
+    return intoLlc ? sim->llcHitCycles : MEMORY_CYCLES;
+}
+
+void completeWriteback(unsigned long long address, bool intoLlc)
+{
+    if (intoLlc)
+    {
+        insertIntoLlc(address, true);
+    }
+    else
+    {
+        sim->memoryWritebacks++;
+    }
+}
+
+void evictCleanLine(int processorId, unsigned long long address)
+{
+    if (sim->llcWays > 0 && sim->llcInclusion == LlcInclusion::EXCLUSIVE && !heldByPeer(processorId, address))
+    {
+        insertIntoLlc(address, false);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef LLC_HPP
+#define LLC_HPP
+
+#include <string>
+#include "main.hpp"
+
+using namespace std;
+
+// Shared last-level cache behind the bus (--llc). Bus fills that no peer
+// cache supplies look the block up in the LLC instead of going straight to
+// memory, and writebacks the LLC takes cost its hit latency instead of
+// memory's. The LLC is updated when the bus grants a request; no other
+// transfer is in flight then, so every L1 fill lands in the LLC state its
+// grant left behind. Without an LLC (llcWays 0) every transfer costs
+// MEMORY_CYCLES, as before.
+
+// Cycles of a block transfer from or to memory
+const int MEMORY_CYCLES = 100;
+
+// Display name and --llc-inclusion parsing for inclusion policies
+const char *llcInclusionName(LlcInclusion inclusion);
+bool parseLlcInclusion(const string &name, LlcInclusion &inclusion);
+
+// Empty the bound simulation's LLC, if it has one
+void initializeLlc();
+
+// A bus fill of the block at address that no peer cache supplies: look it
+// up, updating the LLC for the inclusion policy, and return the cycles of
+// the transfer
+int fetchFromLlc(unsigned long long address);
+
+// Whether a writeback of a core's block goes into the LLC rather than to
+// memory; evicting is false for the writeback of a snooped modified copy
+bool llcTakesWriteback(int processorId, unsigned long long address, bool evicting);
+
+// Cycles of a writeback into the LLC (intoLlc) or to memory
+int writebackCycles(bool intoLlc);
+
+// A writeback transfer finished
+void completeWriteback(unsigned long long address, bool intoLlc);
+
+// A core dropped a clean copy of a block to make room for a fill
+void evictCleanLine(int processorId, unsigned long long address);
+
+#endif // LLC_HPP
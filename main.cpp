@@ -6,354 +6,264 @@
 #include <algorithm>
 #include <cstring>
 #include <cstdlib>
+#include <cstdio>
 #include <fstream>
+#include <thread>
+#include <chrono>
 #include "main.hpp"
-#include "bus.hpp"
 #include "cache.hpp"
+#include "llc.hpp"
+#include "trace.hpp"
+#include "codec.hpp"
+#include "snoop.hpp"
+#include "sweep.hpp"
+#include "stackdist.hpp"
+#include "simulator.hpp"
+#include "intervals.hpp"
+#include "synthetic.hpp"
 
 using namespace std;
 
-// Global configuration parameters
-int numSetBits = 2;
-int numBlockBits = 4;
-int associativity = 2;
-
-// Bus queues and data structures
-vector<BusTransaction> pendingRequests;
-set<int> activeWriteSet;
-vector<BusDataTransfer> dataTransferQueue;
-vector<int> totalCycles;
-vector<int> executedInstructions;
-CacheUnit processorCaches[4];
-vector<vector<CoherenceState>> coherenceTable[4];
-
-// Memory traces for each processor
-vector<pair<char, const char *>> processorTrace0;
-vector<pair<char, const char *>> processorTrace1;
-vector<pair<char, const char *>> processorTrace2;
-vector<pair<char, const char *>> processorTrace3;
-
-// Statistics counters
-vector<int> readCount(4, 0);
-vector<int> writeCount(4, 0);
-vector<int> missCount(4, 0);
-vector<int> evictionCount(4, 0);
-vector<int> writebackCount(4, 0);
-vector<int> invalidationCount(4, 0);
-vector<long long> trafficBytes(4, 0);
-vector<int> stalledCycles(4, 0);
-int busTransactionCount = 0;
-long long totalBusTraffic = 0;
+void displayUsageHelp(const char *programName)
+{
+    cout << "Usage: " << programName << " (-t <tracefile> | --synthetic <spec>) -s <s> -E <E> -b <b> [-n <cores>]\n"
+         << "       [-o <outfilename>] [-r <policy>] [--stream <entries>] [--event-driven]\n"
+         << "       [--functional] [--parallel <threads> [--quantum <cycles>]] [--ffwd <n>] [--sim <m>]\n"
+         << "       [--sample <period>,<window>[,<warm-up>]]\n"
+         << "       [--simd <impl>] [--snoop-filter] [--sweep <spec> [--jobs <n>]]\n"
+         << "       [--llc <s>,<E>,<b> [--llc-policy <policy>] [--llc-inclusion <policy>]\n"
+         << "       [--llc-latency <cycles>]]\n"
+         << "       [--miss-curves <max s>,<max E>] [--checkpoint <file> (--checkpoint-cycle <n> |\n"
+         << "       --checkpoint-accesses <n>)] [--restore <file>]\n"
+         << "       [--stats-interval <cycles> --stats-file <file>] [-h]\n"
+         << "       " << programName << " convert <app> <binfile> [-n <cores>]\n"
+         << "       " << programName << " compress <app|binfile> <zfile> [-n <cores>]\n"
+         << "\nOptions:\n"
+         << "  -t <tracefile>  Name of the parallel application (e.g. app1) whose per-core traces\n"
+         << "                  are to be used in simulation, or a trace file made by convert/compress.\n"
+         << "  --synthetic <spec>\n"
+         << "                  Generate each core's accesses instead of reading traces, e.g.\n"
+         << "                  \"pattern=zipf;n=1000000;footprint=1048576;seed=7\". Patterns: seq,\n"
+         << "                  stride, uniform, zipf, prodcons, migratory, lock, falseshare.\n"
+         << "  -n <cores>      Number of cores, 1 to " << MAX_CORES << " (default 4); loads <app>_proc0..n-1.trace.\n"
+         << "  -s <s>          Number of set index bits (number of sets in the cache = S = 2^s).\n"
+         << "  -E <E>          Associativity (number of cache lines per set).\n"
+         << "  -b <b>          Number of block bits (block size = B = 2^b).\n"
+         << "  -o <outfilename>Log output in file for plotting etc.\n"
+         << "  -r <policy>     Replacement policy: lru (default), plru, srrip, brrip, nru, random.\n"
+         << "  --stream <entries>\n"
+         << "                  Stream traces through two buffers of <entries> records per core,\n"
+         << "                  filled by background threads, instead of loading them whole.\n"
+         << "  --simd <impl>   Tag matching: auto (default, widest supported), avx2, sse4, scalar.\n"
+         << "  --event-driven  Skip cycles in which every core waits on the bus; results are\n"
+         << "                  identical to the cycle-by-cycle simulation.\n"
+         << "  --functional    Untimed run: cores take turns one access at a time and each\n"
+         << "                  access completes its MESI transitions at once. Reports the same\n"
+         << "                  event counters but no cycles; combines with --sweep.\n"
+         << "  --parallel <threads>\n"
+         << "                  Run cores ahead on up to <threads> host threads, merging bus and\n"
+         << "                  coherence events in core order at barriers every quantum.\n"
+         << "  --quantum <cycles>\n"
+         << "                  Cycles between --parallel barriers (default 1, identical to the\n"
+         << "                  serial engine). Longer quanta report their run-ahead error.\n"
+         << "  --ffwd <n>      Warm the caches with the first <n> accesses of every core, applied\n"
+         << "                  untimed as in --functional; counters start after them.\n"
+         << "  --sim <m>       Simulate only the next <m> accesses of every core in detail.\n"
+         << "  --sample <period>,<window>[,<warm-up>]\n"
+         << "                  Sampled run: of every <period> accesses per core, warm the caches\n"
+         << "                  untimed, run the last <warm-up> + <window> in detail and measure\n"
+         << "                  the <window>. Reports cycles, miss rate and bus traffic estimated\n"
+         << "                  for the whole run with 95% confidence intervals.\n"
+         << "  --snoop-filter  Track the sharers of every cached block so coherence actions\n"
+         << "                  probe only those caches; reports the snoops avoided.\n"
+         << "  --llc <s>,<E>,<b>\n"
+         << "                  Shared last-level cache behind the bus: fills no peer supplies and\n"
+         << "                  writebacks it takes cost its hit latency instead of memory's 100.\n"
+         << "  --llc-policy <policy>\n"
+         << "                  LLC replacement policy, as for -r (default lru).\n"
+         << "  --llc-inclusion <policy>\n"
+         << "                  inclusive (default; LLC evictions invalidate L1 copies), exclusive\n"
+         << "                  (holds L1 victims only; needs the L1's b) or nine.\n"
+         << "  --llc-latency <cycles>\n"
+         << "                  Cycles of a block transfer from or to the LLC (default 20).\n"
+         << "  --sweep <spec>  Simulate many configurations in one process and write a table\n"
+         << "                  (CSV, or JSON if -o ends in .json) instead of the report. <spec> is\n"
+         << "                  a grid such as \"s=0-6;E=1,2,4;b=5;r=lru,srrip\" (omitted keys use\n"
+         << "                  -s/-E/-b/-r) or @file listing \"s E b [policy]\" per line.\n"
+         << "  --jobs <n>      Sweep worker threads (default: host hardware threads).\n"
+         << "  --miss-curves <max s>,<max E>\n"
+         << "                  Stack-distance pass that writes per-core LRU miss rates for every\n"
+         << "                  s in [0, max s] and E in [1, max E] at block bits -b (CSV, or JSON\n"
+         << "                  if -o ends in .json), counting coherence-invalidation misses.\n"
+         << "  --checkpoint <file>\n"
+         << "                  Write the complete simulation state to <file> at the point given\n"
+         << "                  below, counted from the start of this run, then finish the run.\n"
+         << "  --checkpoint-cycle <n>\n"
+         << "                  Checkpoint at cycle <n> (round <n> with --functional; --parallel\n"
+         << "                  rounds up to a whole quantum).\n"
+         << "  --checkpoint-accesses <n>\n"
+         << "                  Checkpoint at the first cycle by which <n> accesses have retired.\n"
+         << "  --restore <file>\n"
+         << "                  Continue a checkpoint taken on the same traces (-t, -n). Its cache\n"
+         << "                  and engine settings replace -s/-E/-b/-r and the engine options.\n"
+         << "  --stats-interval <cycles>\n"
+         << "                  Every <cycles> cycles (rounds with --functional), write each core's\n"
+         << "                  counters since the previous record, then the run's totals.\n"
+         << "  --stats-file <file>\n"
+         << "                  Where --stats-interval writes: CSV rows, or JSON lines if <file>\n"
+         << "                  ends in .json.\n"
+         << "  -h              Print this help message.\n"
+         << "\nSubcommands:\n"
+         << "  convert <app> <binfile>  Pack <app>_procK.trace into one binary trace\n"
+         << "                           file that -t maps directly without parsing.\n"
+         << "  compress <src> <zfile>   Delta/varint encode text or binary traces into a\n"
+         << "                           compressed trace decoded block by block during -t.\n";
+}
 
-vector<bool> processorRunning(4, true);
+// Set traceCoreCount from a -n argument; false unless it is in [1, MAX_CORES]
+bool parseCoreCount(const char *text)
+{
+    char *parseEnd;
+    long coreCount = strtol(text, &parseEnd, 10);
+    if (*parseEnd != '\0' || coreCount < 1 || coreCount > MAX_CORES)
+    {
+        return false;
+    }
+    traceCoreCount = (int)coreCount;
+    return true;
+}
 
-// Load trace files for all four processors
-bool loadProcessorTraces(const string &appPrefix)
+// Subcommands take two operands and an optional trailing -n <cores>
+bool parseSubcommandCores(int argc, char *argv[])
 {
-    vector<vector<pair<char, const char *>> *> traceArrays = {
-        &processorTrace0, &processorTrace1, &processorTrace2, &processorTrace3
-    };
+    if (argc == 4)
+    {
+        return true;
+    }
+    return argc == 6 && strcmp(argv[4], "-n") == 0 && parseCoreCount(argv[5]);
+}
 
-    int procIdx = 0;
-    while (procIdx < 4)
+// Accesses the report counts; a sampled run counts its whole region
+long long reportedAccesses(const SimulatorStats &stats, bool sampled)
+{
+    if (sampled)
     {
-        // Build filename: app1_proc0.trace, app1_proc1.trace, etc.
-        string traceFilename = appPrefix + "_proc" + to_string(procIdx) + ".trace";
-        ifstream inputFile(traceFilename);
+        return stats.sampling.totalAccesses;
+    }
+    long long accesses = 0;
+    for (const CoreStats &core : stats.cores)
+    {
+        accesses += core.instructions;
+    }
+    return accesses;
+}
 
-        if (!inputFile.is_open())
+// Where this process's host time went, on stderr so reports stay comparable.
+// start is the simulation's state before this process advanced it.
+void printHostProfile(double loadSeconds, double reportSeconds, const SimulatorStats &start,
+                      const SimulatorStats &end, const SimulatorConfig &config)
+{
+    const HostProfile &host = end.host;
+    long long accesses = reportedAccesses(end, config.samplePeriod > 0) - reportedAccesses(start, config.samplePeriod > 0);
+    long long cycles = end.clock - start.clock;
+    double seconds = host.engineSeconds;
+
+    cerr << fixed << setprecision(3) << "Host profile:\n"
+         << "  Trace loading:            " << setw(10) << loadSeconds << " s\n"
+         << "  Simulation:               " << setw(10) << seconds << " s";
+    if (seconds > 0.0 && accesses > 0)
+    {
+        cerr << setprecision(2) << "  " << accesses / seconds / 1e6 << " M accesses/s";
+        if (!config.functional)
         {
-            cerr << "Error: Could not open trace file " << traceFilename << endl;
-            return false;
+            cerr << "  " << cycles / seconds / 1e6 << " M cycles/s";
         }
+        cerr << setprecision(0) << "  " << (double)host.engineTicks / accesses << " host cycles/access";
+    }
+    cerr << "\n";
 
-        traceArrays[procIdx]->clear();
-
-        string currentLine;
-        while (getline(inputFile, currentLine))
+    // Phase ticks are converted at the engine's ticks per second
+    static const char *const phaseNames[] = {"executeMemoryOperation", "Bus request handling", "Data transfers"};
+    unsigned long long phaseTotal = 0;
+    int phaseIdx = 0;
+    while (phaseIdx < (int)HostPhase::COUNT)
+    {
+        phaseTotal += host.phaseTicks[phaseIdx];
+        phaseIdx++;
+    }
+    if (phaseTotal > 0 && host.engineTicks > 0)
+    {
+        double secondsPerTick = seconds / host.engineTicks;
+        phaseIdx = 0;
+        while (phaseIdx <= (int)HostPhase::COUNT)
         {
-            // Skip empty lines and comments
-            if (currentLine.empty() || currentLine[0] == '#')
+            bool rest = phaseIdx == (int)HostPhase::COUNT;
+            unsigned long long ticks = rest ? (host.engineTicks > phaseTotal ? host.engineTicks - phaseTotal : 0)
+                                            : host.phaseTicks[phaseIdx];
+            cerr << "    " << left << setw(24) << (rest ? "Rest of the engine" : phaseNames[phaseIdx]) << right
+                 << setprecision(3) << setw(10) << ticks * secondsPerTick << " s  " << setprecision(1) << setw(5)
+                 << 100.0 * ticks / host.engineTicks << "%";
+            if (!rest && host.phaseCalls[phaseIdx] > 0)
             {
-                continue;
-            }
-
-            // Parse format: "R 0x817b08" or "W 0x817b08"
-            istringstream lineParser(currentLine);
-            char operation;
-            string hexAddress;
-
-            if (lineParser >> operation >> hexAddress)
-            {
-                if (operation == 'R' || operation == 'W')
-                {
-                    // Create persistent copy of address string
-                    char *addressBuffer = new char[hexAddress.length() + 1];
-                    strcpy(addressBuffer, hexAddress.c_str());
-                    traceArrays[procIdx]->push_back({operation, addressBuffer});
-                }
+                cerr << "  " << setw(12) << host.phaseCalls[phaseIdx] << " calls  " << setw(8)
+                     << ticks * secondsPerTick * 1e9 / host.phaseCalls[phaseIdx] << " ns/call";
             }
+            cerr << "\n";
+            phaseIdx++;
         }
-
-        inputFile.close();
-        procIdx++;
     }
-
-    return true;
+    cerr << setprecision(3) << "  Report printing:          " << setw(10) << reportSeconds << " s" << endl;
 }
 
-void runMulticoreSimulation()
+int main(int argc, char *argv[])
 {
-    // Track current position in each processor's trace
-    vector<size_t> tracePosition(4, 0);
-
-    // Array of trace references
-    const vector<vector<pair<char, const char *>>> allTraces = {
-        processorTrace0, processorTrace1, processorTrace2, processorTrace3
-    };
-
-    // Simulation control
-    bool simulationActive = true;
-    int currentCycle = 0;
-    int peakCycles = 0;
-
-    while (simulationActive)
+    SimulatorConfig config;
+    string applicationPrefix;
+    string syntheticText;
+    string outputFilename;
+    size_t streamChunkEntries = 0;
+    string simdRequest;
+    string sweepSpec;
+    int curveSetBits = -1;
+    int curveWays = 0;
+    bool llcOptionGiven = false;
+    int sweepJobs = thread::hardware_concurrency() > 0 ? (int)thread::hardware_concurrency() : 1;
+    string checkpointPath;
+    string restorePath;
+    long long checkpointCycle = -1;
+    long long checkpointAccesses = -1;
+    long long statsInterval = 0;
+    string statsPath;
+
+    // Text-to-binary trace conversion subcommand
+    if (argc >= 2 && strcmp(argv[1], "convert") == 0)
     {
-        // Process each processor in round-robin order
-        int procId = 0;
-        while (procId < 4)
+        if (!parseSubcommandCores(argc, argv))
         {
-            // Skip completed processors
-            if (!processorRunning[procId])
-            {
-                procId++;
-                continue;
-            }
-
-            // Check if processor has remaining instructions
-            if (tracePosition[procId] < allTraces[procId].size())
-            {
-                pair<char, const char *> currentOp = allTraces[procId][tracePosition[procId]];
-                executeMemoryOperation(currentOp, procId);
-            }
-            else
-            {
-                processorRunning[procId] = false;
-            }
-            procId++;
-        }
-
-        processBusTransactions();
-
-        // Advance trace position for non-stalled processors
-        int updateIdx = 0;
-        while (updateIdx < 4)
-        {
-            if (!processorCaches[updateIdx].isStalled && processorRunning[updateIdx])
-            {
-                tracePosition[updateIdx]++;
-                executedInstructions[updateIdx]++;
-                if (tracePosition[updateIdx] == allTraces[updateIdx].size())
-                {
-                    processorRunning[updateIdx] = false;
-                }
-            }
-            updateIdx++;
+            cerr << "Error: convert expects <app> <binfile> [-n <cores>].\n";
+            displayUsageHelp(argv[0]);
+            return 1;
         }
-
-        // Check if simulation should continue
-        simulationActive = false;
-        int checkIdx = 0;
-        while (checkIdx < 4)
+        if (!convertTextTraces(argv[2], argv[3]))
         {
-            if (processorRunning[checkIdx] || processorCaches[checkIdx].isStalled || !dataTransferQueue.empty())
-            {
-                simulationActive = true;
-                break;
-            }
-            checkIdx++;
+            return 1;
         }
-
-        currentCycle++;
-        peakCycles = max(peakCycles, currentCycle);
+        cout << "Wrote binary trace " << argv[3] << endl;
+        return 0;
     }
 
-    // Count reads and writes from traces
-    int countIdx = 0;
-    while (countIdx < 4)
+    // Compressed trace encoding subcommand
+    if (argc >= 2 && strcmp(argv[1], "compress") == 0)
     {
-        size_t opIdx = 0;
-        while (opIdx < allTraces[countIdx].size())
+        if (!parseSubcommandCores(argc, argv))
         {
-            if (allTraces[countIdx][opIdx].first == 'R')
-            {
-                readCount[countIdx]++;
-            }
-            else if (allTraces[countIdx][opIdx].first == 'W')
-            {
-                writeCount[countIdx]++;
-            }
-            opIdx++;
+            cerr << "Error: compress expects <app|binfile> <zfile> [-n <cores>].\n";
+            displayUsageHelp(argv[0]);
+            return 1;
         }
-        countIdx++;
-    }
-
-    // Calculate totals
-    int blockBytes = 1 << numBlockBits;
-    int setCount = 1 << numSetBits;
-    double cacheSizeKB = (setCount * associativity * blockBytes) / 1024.0;
-    
-    int totalInstructions = 0;
-    int totalReads = 0;
-    int totalWrites = 0;
-    int totalMisses = 0;
-    int totalEvictions = 0;
-    int totalWritebacks = 0;
-    int totalInvalidations = 0;
-    long long totalDataTraffic = 0;
-    
-    int calcIdx = 0;
-    while (calcIdx < 4)
-    {
-        totalInstructions += executedInstructions[calcIdx];
-        totalReads += readCount[calcIdx];
-        totalWrites += writeCount[calcIdx];
-        totalMisses += missCount[calcIdx];
-        totalEvictions += evictionCount[calcIdx];
-        totalWritebacks += writebackCount[calcIdx];
-        totalInvalidations += invalidationCount[calcIdx];
-        totalDataTraffic += trafficBytes[calcIdx];
-        calcIdx++;
-    }
-
-    // Print simulation results
-    cout << "\n╔══════════════════════════════════════════════════════════════════╗\n";
-    cout << "║           MULTICORE CACHE SIMULATOR - SIMULATION REPORT          ║\n";
-    cout << "╚══════════════════════════════════════════════════════════════════╝\n\n";
-
-    cout << "┌──────────────────────────────────────────────────────────────────┐\n";
-    cout << "│                     SIMULATION PARAMETERS                        │\n";
-    cout << "├──────────────────────────────────────────────────────────────────┤\n";
-    cout << "│  Set Index Bits (s):        " << setw(8) << numSetBits << "                            │\n";
-    cout << "│  Associativity (E):         " << setw(8) << associativity << "                            │\n";
-    cout << "│  Block Bits (b):            " << setw(8) << numBlockBits << "                            │\n";
-    cout << "│  Block Size:                " << setw(5) << blockBytes << " bytes                        │\n";
-    cout << "│  Number of Sets:            " << setw(8) << setCount << "                            │\n";
-    cout << fixed << setprecision(2);
-    cout << "│  Cache Size (per core):     " << setw(5) << cacheSizeKB << " KB                          │\n";
-    cout << "│  Total Cache Size:          " << setw(5) << cacheSizeKB * 4 << " KB                          │\n";
-    cout << "├──────────────────────────────────────────────────────────────────┤\n";
-    cout << "│  Coherence Protocol:        MESI (Illinois)                      │\n";
-    cout << "│  Write Policy:              Write-back, Write-allocate           │\n";
-    cout << "│  Replacement Policy:        LRU (Least Recently Used)            │\n";
-    cout << "│  Bus Architecture:          Central Snooping Bus                 │\n";
-    cout << "│  Number of Cores:           4                                    │\n";
-    cout << "└──────────────────────────────────────────────────────────────────┘\n\n";
-
-    cout << "┌──────────────────────────────────────────────────────────────────┐\n";
-    cout << "│                     PER-CORE STATISTICS                          │\n";
-    cout << "└──────────────────────────────────────────────────────────────────┘\n\n";
-
-    int statIdx = 0;
-    while (statIdx < 4)
-    {
-        double missPercent = (readCount[statIdx] + writeCount[statIdx] > 0) 
-            ? (missCount[statIdx] * 100.0) / (readCount[statIdx] + writeCount[statIdx]) : 0.0;
-        double hitPercent = 100.0 - missPercent;
-        double readPercent = (readCount[statIdx] + writeCount[statIdx] > 0)
-            ? (readCount[statIdx] * 100.0) / (readCount[statIdx] + writeCount[statIdx]) : 0.0;
-        double writePercent = 100.0 - readPercent;
-        int cacheHits = readCount[statIdx] + writeCount[statIdx] - missCount[statIdx];
-        double ipc = (totalCycles[statIdx] + executedInstructions[statIdx] > 0)
-            ? (double)executedInstructions[statIdx] / (totalCycles[statIdx] + executedInstructions[statIdx]) : 0.0;
-
-        cout << "┌─────────────────────── CORE " << statIdx << " ───────────────────────────────────┐\n";
-        cout << "│  Memory Access Summary:                                          │\n";
-        cout << "│    Total Instructions:      " << setw(12) << executedInstructions[statIdx] << "                      │\n";
-        cout << "│    Total Reads:             " << setw(12) << readCount[statIdx] << " (" << setw(5) << fixed << setprecision(2) << readPercent << "%)               │\n";
-        cout << "│    Total Writes:            " << setw(12) << writeCount[statIdx] << " (" << setw(5) << writePercent << "%)               │\n";
-        cout << "│                                                                  │\n";
-        cout << "│  Cache Performance:                                              │\n";
-        cout << "│    Cache Hits:              " << setw(12) << cacheHits << "                      │\n";
-        cout << "│    Cache Misses:            " << setw(12) << missCount[statIdx] << "                      │\n";
-        cout << fixed << setprecision(5);
-        cout << "│    Hit Rate:                " << setw(11) << hitPercent << "%                      │\n";
-        cout << "│    Miss Rate:               " << setw(11) << missPercent << "%                      │\n";
-        cout << "│                                                                  │\n";
-        cout << "│  Cache Events:                                                   │\n";
-        cout << "│    Evictions:               " << setw(12) << evictionCount[statIdx] << "                      │\n";
-        cout << "│    Writebacks:              " << setw(12) << writebackCount[statIdx] << "                      │\n";
-        cout << "│    Bus Invalidations:       " << setw(12) << invalidationCount[statIdx] << "                      │\n";
-        cout << "│                                                                  │\n";
-        cout << "│  Timing & Traffic:                                               │\n";
-        cout << "│    Execution Cycles:        " << setw(12) << totalCycles[statIdx] + executedInstructions[statIdx] << "                      │\n";
-        cout << "│    Idle/Stall Cycles:       " << setw(12) << stalledCycles[statIdx] << "                      │\n";
-        cout << fixed << setprecision(4);
-        cout << "│    IPC (approx):            " << setw(12) << ipc << "                      │\n";
-        cout << "│    Data Traffic:            " << setw(9) << trafficBytes[statIdx] << " bytes                 │\n";
-        cout << "└──────────────────────────────────────────────────────────────────┘\n\n";
-        statIdx++;
+        return compressTraces(argv[2], argv[3]) ? 0 : 1;
     }
 
-    double overallMissRate = (totalReads + totalWrites > 0) 
-        ? (totalMisses * 100.0) / (totalReads + totalWrites) : 0.0;
-    double overallHitRate = 100.0 - overallMissRate;
-
-    cout << "┌──────────────────────────────────────────────────────────────────┐\n";
-    cout << "│                     AGGREGATE STATISTICS                         │\n";
-    cout << "├──────────────────────────────────────────────────────────────────┤\n";
-    cout << "│  Total Instructions (all cores):    " << setw(14) << totalInstructions << "            │\n";
-    cout << "│  Total Memory Accesses:             " << setw(14) << totalReads + totalWrites << "            │\n";
-    cout << "│  Total Reads:                       " << setw(14) << totalReads << "            │\n";
-    cout << "│  Total Writes:                      " << setw(14) << totalWrites << "            │\n";
-    cout << "│  Total Cache Hits:                  " << setw(14) << (totalReads + totalWrites - totalMisses) << "            │\n";
-    cout << "│  Total Cache Misses:                " << setw(14) << totalMisses << "            │\n";
-    cout << fixed << setprecision(5);
-    cout << "│  Overall Hit Rate:                  " << setw(13) << overallHitRate << "%            │\n";
-    cout << "│  Overall Miss Rate:                 " << setw(13) << overallMissRate << "%            │\n";
-    cout << "│  Total Evictions:                   " << setw(14) << totalEvictions << "            │\n";
-    cout << "│  Total Writebacks:                  " << setw(14) << totalWritebacks << "            │\n";
-    cout << "│  Total Invalidations:               " << setw(14) << totalInvalidations << "            │\n";
-    cout << "└──────────────────────────────────────────────────────────────────┘\n\n";
-
-    cout << "┌──────────────────────────────────────────────────────────────────┐\n";
-    cout << "│                     BUS & COHERENCE SUMMARY                      │\n";
-    cout << "├──────────────────────────────────────────────────────────────────┤\n";
-    cout << "│  Total Bus Transactions:            " << setw(14) << busTransactionCount << "            │\n";
-    cout << "│  Total Bus Traffic:                 " << setw(11) << totalBusTraffic << " bytes         │\n";
-    cout << "│  Total Core Data Traffic:           " << setw(11) << totalDataTraffic << " bytes         │\n";
-    double avgBusTransPerInstr = (totalInstructions > 0) 
-        ? (double)busTransactionCount / totalInstructions : 0.0;
-    cout << fixed << setprecision(6);
-    cout << "│  Bus Transactions per Instruction:  " << setw(14) << avgBusTransPerInstr << "            │\n";
-    cout << "└──────────────────────────────────────────────────────────────────┘\n\n";
-
-    cout << "┌──────────────────────────────────────────────────────────────────┐\n";
-    cout << "│                     TIMING SUMMARY                               │\n";
-    cout << "├──────────────────────────────────────────────────────────────────┤\n";
-    cout << "│  Total Simulation Cycles:           " << setw(14) << currentCycle - 1 << "            │\n";
-    cout << "│  Maximum Execution Time:            " << setw(14) << peakCycles << "            │\n";
-    cout << "└──────────────────────────────────────────────────────────────────┘\n";
-}
-
-void displayUsageHelp(const char *programName)
-{
-    cout << "Usage: " << programName << " -t <tracefile> -s <s> -E <E> -b <b> [-o <outfilename>] [-h]\n"
-         << "\nOptions:\n"
-         << "  -t <tracefile>  Name of the parallel application (e.g. app1) whose 4 traces are\n"
-         << "                  to be used in simulation.\n"
-         << "  -s <s>          Number of set index bits (number of sets in the cache = S = 2^s).\n"
-         << "  -E <E>          Associativity (number of cache lines per set).\n"
-         << "  -b <b>          Number of block bits (block size = B = 2^b).\n"
-         << "  -o <outfilename>Log output in file for plotting etc.\n"
-         << "  -h              Print this help message.\n";
-}
-
-int main(int argc, char *argv[])
-{
-    string applicationPrefix;
-    string outputFilename;
-
     // Parse command line arguments
     int argIdx = 1;
     while (argIdx < argc)
@@ -375,11 +285,31 @@ int main(int argc, char *argv[])
                 return 1;
             }
         }
+        else if (strcmp(argv[argIdx], "--synthetic") == 0)
+        {
+            if (argIdx + 1 < argc)
+            {
+                syntheticText = argv[++argIdx];
+            }
+            else
+            {
+                cerr << "Error: Missing argument for --synthetic option.\n";
+                return 1;
+            }
+        }
+        else if (strcmp(argv[argIdx], "-n") == 0)
+        {
+            if (argIdx + 1 >= argc || !parseCoreCount(argv[++argIdx]))
+            {
+                cerr << "Error: -n needs a core count between 1 and " << MAX_CORES << ".\n";
+                return 1;
+            }
+        }
         else if (strcmp(argv[argIdx], "-s") == 0)
         {
             if (argIdx + 1 < argc)
             {
-                numSetBits = atoi(argv[++argIdx]);
+                config.setBits = atoi(argv[++argIdx]);
             }
             else
             {
@@ -391,7 +321,7 @@ int main(int argc, char *argv[])
         {
             if (argIdx + 1 < argc)
             {
-                associativity = atoi(argv[++argIdx]);
+                config.ways = atoi(argv[++argIdx]);
             }
             else
             {
@@ -403,7 +333,7 @@ int main(int argc, char *argv[])
         {
             if (argIdx + 1 < argc)
             {
-                numBlockBits = atoi(argv[++argIdx]);
+                config.blockBits = atoi(argv[++argIdx]);
             }
             else
             {
@@ -424,6 +354,214 @@ int main(int argc, char *argv[])
             }
             cout << "Output file name: " << argv[argIdx] << endl;
         }
+        else if (strcmp(argv[argIdx], "-r") == 0)
+        {
+            if (argIdx + 1 < argc)
+            {
+                if (!parseReplacementPolicy(argv[++argIdx], config.policy))
+                {
+                    cerr << "Error: Unknown replacement policy " << argv[argIdx] << ".\n";
+                    return 1;
+                }
+            }
+            else
+            {
+                cerr << "Error: Missing argument for -r option.\n";
+                return 1;
+            }
+        }
+        else if (strcmp(argv[argIdx], "--simd") == 0)
+        {
+            if (argIdx + 1 < argc)
+            {
+                simdRequest = argv[++argIdx];
+            }
+            else
+            {
+                cerr << "Error: Missing argument for --simd option.\n";
+                return 1;
+            }
+        }
+        else if (strcmp(argv[argIdx], "--event-driven") == 0)
+        {
+            config.eventDriven = true;
+        }
+        else if (strcmp(argv[argIdx], "--functional") == 0)
+        {
+            config.functional = true;
+        }
+        else if (strcmp(argv[argIdx], "--parallel") == 0)
+        {
+            if (argIdx + 1 < argc && atoi(argv[argIdx + 1]) > 0)
+            {
+                config.parallelThreads = atoi(argv[++argIdx]);
+            }
+            else
+            {
+                cerr << "Error: --parallel needs a positive thread count.\n";
+                return 1;
+            }
+        }
+        else if (strcmp(argv[argIdx], "--quantum") == 0)
+        {
+            if (argIdx + 1 < argc && atoi(argv[argIdx + 1]) > 0)
+            {
+                config.quantumCycles = atoi(argv[++argIdx]);
+            }
+            else
+            {
+                cerr << "Error: --quantum needs a positive cycle count.\n";
+                return 1;
+            }
+        }
+        else if (strcmp(argv[argIdx], "--snoop-filter") == 0)
+        {
+            config.snoopFilter = true;
+        }
+        else if (strcmp(argv[argIdx], "--llc") == 0)
+        {
+            if (argIdx + 1 >= argc || sscanf(argv[++argIdx], "%d,%d,%d", &config.llcSetBits, &config.llcWays,
+                                             &config.llcBlockBits) != 3 || config.llcWays < 1)
+            {
+                cerr << "Error: --llc needs <s>,<E>,<b> with E >= 1.\n";
+                return 1;
+            }
+        }
+        else if (strcmp(argv[argIdx], "--llc-policy") == 0)
+        {
+            if (argIdx + 1 >= argc || !parseReplacementPolicy(argv[++argIdx], config.llcPolicy))
+            {
+                cerr << "Error: --llc-policy needs a replacement policy (lru, plru, srrip, brrip, nru, random).\n";
+                return 1;
+            }
+            llcOptionGiven = true;
+        }
+        else if (strcmp(argv[argIdx], "--llc-inclusion") == 0)
+        {
+            if (argIdx + 1 >= argc || !parseLlcInclusion(argv[++argIdx], config.llcInclusion))
+            {
+                cerr << "Error: --llc-inclusion needs inclusive, exclusive or nine.\n";
+                return 1;
+            }
+            llcOptionGiven = true;
+        }
+        else if (strcmp(argv[argIdx], "--llc-latency") == 0)
+        {
+            if (argIdx + 1 < argc && atoi(argv[argIdx + 1]) > 0)
+            {
+                config.llcHitCycles = atoi(argv[++argIdx]);
+            }
+            else
+            {
+                cerr << "Error: --llc-latency needs a positive cycle count.\n";
+                return 1;
+            }
+            llcOptionGiven = true;
+        }
+        else if (strcmp(argv[argIdx], "--sweep") == 0)
+        {
+            if (argIdx + 1 < argc)
+            {
+                sweepSpec = argv[++argIdx];
+            }
+            else
+            {
+                cerr << "Error: Missing argument for --sweep option.\n";
+                return 1;
+            }
+        }
+        else if (strcmp(argv[argIdx], "--miss-curves") == 0)
+        {
+            if (argIdx + 1 >= argc || sscanf(argv[++argIdx], "%d,%d", &curveSetBits, &curveWays) != 2 ||
+                curveSetBits < 0 || curveSetBits > 24 || curveWays < 1)
+            {
+                cerr << "Error: --miss-curves needs <max s>,<max E> with 0 <= s <= 24 and E >= 1.\n";
+                return 1;
+            }
+        }
+        else if (strcmp(argv[argIdx], "--jobs") == 0)
+        {
+            if (argIdx + 1 < argc && atoi(argv[argIdx + 1]) > 0)
+            {
+                sweepJobs = atoi(argv[++argIdx]);
+            }
+            else
+            {
+                cerr << "Error: --jobs needs a positive thread count.\n";
+                return 1;
+            }
+        }
+        else if (strcmp(argv[argIdx], "--stream") == 0)
+        {
+            if (argIdx + 1 < argc && atol(argv[argIdx + 1]) > 0)
+            {
+                streamChunkEntries = atol(argv[++argIdx]);
+            }
+            else
+            {
+                cerr << "Error: --stream needs a positive chunk size.\n";
+                return 1;
+            }
+        }
+        else if (strcmp(argv[argIdx], "--checkpoint") == 0 || strcmp(argv[argIdx], "--restore") == 0 ||
+                 strcmp(argv[argIdx], "--stats-file") == 0)
+        {
+            if (argIdx + 1 >= argc)
+            {
+                cerr << "Error: Missing file name for " << argv[argIdx] << " option.\n";
+                return 1;
+            }
+            string &path = strcmp(argv[argIdx], "--checkpoint") == 0 ? checkpointPath
+                           : strcmp(argv[argIdx], "--restore") == 0  ? restorePath
+                                                                      : statsPath;
+            path = argv[++argIdx];
+        }
+        else if (strcmp(argv[argIdx], "--stats-interval") == 0)
+        {
+            if (argIdx + 1 < argc && atoll(argv[argIdx + 1]) > 0)
+            {
+                statsInterval = atoll(argv[++argIdx]);
+            }
+            else
+            {
+                cerr << "Error: --stats-interval needs a positive cycle count.\n";
+                return 1;
+            }
+        }
+        else if (strcmp(argv[argIdx], "--ffwd") == 0 || strcmp(argv[argIdx], "--sim") == 0)
+        {
+            bool isWarmUp = strcmp(argv[argIdx], "--ffwd") == 0;
+            long long minimum = isWarmUp ? 0 : 1;
+            if (argIdx + 1 >= argc || atoll(argv[argIdx + 1]) < minimum)
+            {
+                cerr << "Error: " << argv[argIdx] << " needs an access count >= " << minimum << ".\n";
+                return 1;
+            }
+            long long &accesses = isWarmUp ? config.fastForward : config.region;
+            accesses = atoll(argv[++argIdx]);
+        }
+        else if (strcmp(argv[argIdx], "--sample") == 0)
+        {
+            int fields = argIdx + 1 < argc ? sscanf(argv[++argIdx], "%lld,%lld,%lld", &config.samplePeriod,
+                                                    &config.sampleWindow, &config.sampleWarmup) : 0;
+            if (fields < 2 || config.sampleWindow < 1 || config.sampleWarmup < 0 ||
+                config.sampleWarmup + config.sampleWindow > config.samplePeriod)
+            {
+                cerr << "Error: --sample needs <period>,<window>[,<warm-up>] with window >= 1 and\n"
+                     << "       warm-up + window <= period.\n";
+                return 1;
+            }
+        }
+        else if (strcmp(argv[argIdx], "--checkpoint-cycle") == 0 || strcmp(argv[argIdx], "--checkpoint-accesses") == 0)
+        {
+            if (argIdx + 1 >= argc || atoll(argv[argIdx + 1]) < 0)
+            {
+                cerr << "Error: " << argv[argIdx] << " needs a count >= 0.\n";
+                return 1;
+            }
+            long long &point = strcmp(argv[argIdx], "--checkpoint-cycle") == 0 ? checkpointCycle : checkpointAccesses;
+            point = atoll(argv[++argIdx]);
+        }
         else
         {
             cerr << "Error: Unknown option " << argv[argIdx] << ".\n";
@@ -433,34 +571,145 @@ int main(int argc, char *argv[])
     }
 
     // Validate required arguments
-    if (applicationPrefix.empty())
+    if (applicationPrefix.empty() == syntheticText.empty())
     {
-        cerr << "Error: Trace file prefix (-t) is required.\n";
+        cerr << "Error: Either a trace file prefix (-t) or a --synthetic workload is required.\n";
         displayUsageHelp(argv[0]);
         return 1;
     }
+    SyntheticSpec syntheticSpec;
+    if (!syntheticText.empty() && !parseSyntheticSpec(syntheticText, syntheticSpec))
+    {
+        return 1;
+    }
+
+    config.cores = traceCoreCount;
+    if (config.functional && config.parallelThreads > 0)
+    {
+        cerr << "Error: --functional is untimed and cannot use the --parallel engine.\n";
+        return 1;
+    }
 
-    // Load trace files
-    if (!loadProcessorTraces(applicationPrefix))
+    if (!checkpointPath.empty() && (checkpointCycle >= 0) == (checkpointAccesses >= 0))
+    {
+        cerr << "Error: --checkpoint needs one of --checkpoint-cycle or --checkpoint-accesses.\n";
+        return 1;
+    }
+    if ((!checkpointPath.empty() || !restorePath.empty()) && (!sweepSpec.empty() || curveSetBits >= 0))
+    {
+        cerr << "Error: Checkpoints apply to a single simulation, not --sweep or --miss-curves.\n";
+        return 1;
+    }
+
+    if (config.samplePeriod > 0 && (config.functional || config.parallelThreads > 0 || !sweepSpec.empty()))
+    {
+        cerr << "Error: --sample measures on the serial timed engine, not with --functional, --parallel or --sweep.\n";
+        return 1;
+    }
+
+    if ((statsInterval > 0) != !statsPath.empty())
+    {
+        cerr << "Error: --stats-interval and --stats-file go together.\n";
+        return 1;
+    }
+    if (statsInterval > 0 && (config.samplePeriod > 0 || !sweepSpec.empty() || curveSetBits >= 0))
+    {
+        cerr << "Error: --stats-interval follows a single full simulation, not --sample, --sweep or --miss-curves.\n";
+        return 1;
+    }
+
+    if (llcOptionGiven && config.llcWays == 0)
+    {
+        cerr << "Error: --llc-policy, --llc-inclusion and --llc-latency configure an --llc.\n";
+        return 1;
+    }
+    if (config.llcWays > 0 && (!sweepSpec.empty() || curveSetBits >= 0))
+    {
+        cerr << "Error: --llc applies to a single simulation, not --sweep or --miss-curves.\n";
+        return 1;
+    }
+
+    if (!sweepSpec.empty() && streamChunkEntries > 0)
+    {
+        cerr << "Error: --sweep shares whole traces between threads and cannot --stream them.\n";
+        return 1;
+    }
+    if (!syntheticText.empty() && streamChunkEntries > 0)
+    {
+        cerr << "Error: --synthetic workloads are generated as they run and have nothing to --stream.\n";
+        return 1;
+    }
+
+    // Load trace files: generate them, stream them, map a binary or compressed
+    // trace, or parse text
+    auto loadStart = chrono::steady_clock::now();
+    bool tracesLoaded = true;
+    TraceFileKind traceKind = detectTraceFile(applicationPrefix);
+    if (!syntheticText.empty())
+    {
+        openSyntheticTraces(syntheticSpec);
+    }
+    else if (streamChunkEntries > 0)
+    {
+        tracesLoaded = openTraceStreams(applicationPrefix, streamChunkEntries);
+    }
+    else if (traceKind == TraceFileKind::BINARY)
+    {
+        tracesLoaded = mapBinaryTrace(applicationPrefix);
+    }
+    else if (traceKind == TraceFileKind::COMPRESSED)
+    {
+        tracesLoaded = mapCompressedTrace(applicationPrefix);
+    }
+    else
+    {
+        tracesLoaded = loadProcessorTraces(applicationPrefix);
+    }
+    if (!tracesLoaded)
     {
         cerr << "Error loading trace files. Exiting.\n";
         return 1;
     }
+    double loadSeconds = chrono::duration<double>(chrono::steady_clock::now() - loadStart).count();
 
-    // Initialize caches and coherence state
-    int initIdx = 0;
-    while (initIdx < 4)
+    if (!simdRequest.empty() && !selectTagMatch(simdRequest))
+    {
+        cerr << "Error: Tag matching implementation " << simdRequest << " is not available on this host.\n";
+        return 1;
+    }
+    // Miss-curve mode: one functional pass yields every s/E point
+    if (curveSetBits >= 0)
     {
-        processorCaches[initIdx].initialize();
-        coherenceTable[initIdx].assign(1 << numSetBits, vector<CoherenceState>(associativity, CoherenceState::INVALID));
-        initIdx++;
+        bool written = runMissCurves(config.blockBits, curveSetBits, curveWays, outputFilename);
+        releaseTraces();
+        return written ? 0 : 1;
     }
 
-    // Initialize counters
-    executedInstructions.assign(4, 0);
-    totalCycles.assign(4, 0);
+    // Sweep mode: every configuration reads the traces loaded above
+    if (!sweepSpec.empty())
+    {
+        vector<SweepConfig> sweepConfigs;
+        SweepConfig defaults = {config.setBits, config.ways, config.blockBits, config.policy};
+        if (!parseSweepSpec(sweepSpec, defaults, sweepConfigs))
+        {
+            releaseTraces();
+            return 1;
+        }
+        materializeTraces();
+        bool swept = runSweep(sweepConfigs, config, sweepJobs, outputFilename);
+        releaseTraces();
+        return swept ? 0 : 1;
+    }
 
-    // Handle output redirection
+    Simulator simulator;
+    const char *configError = simulator.configure(config);
+    if (configError != nullptr)
+    {
+        cerr << "Error: " << configError << "\n";
+        releaseTraces();
+        return 1;
+    }
+    // Open the report file before the run so a bad path fails fast
     ofstream outputFile;
     if (!outputFilename.empty())
     {
@@ -468,46 +717,90 @@ int main(int argc, char *argv[])
         if (!outputFile.is_open())
         {
             cerr << "Error: Could not open output file " << outputFilename << endl;
+            releaseTraces();
             return 1;
         }
-        streambuf *originalBuffer = cout.rdbuf();
-        cout.rdbuf(outputFile.rdbuf());
-
-        runMulticoreSimulation();
+    }
 
-        cout.rdbuf(originalBuffer);
-        outputFile.close();
+    simulator.attachTraces(loadedTraces, loadedSources);
+    if (!restorePath.empty())
+    {
+        const char *restoreError = simulator.restoreCheckpoint(restorePath);
+        if (restoreError == nullptr && simulator.config().cores != traceCoreCount)
+        {
+            restoreError = "The checkpoint has a different core count (-n).";
+        }
+        if (restoreError != nullptr)
+        {
+            cerr << "Error: " << restorePath << ": " << restoreError << "\n";
+            releaseTraces();
+            return 1;
+        }
     }
-    else
+
+    // Interval records and the host profile start from where a restored run
+    // left off
+    SimulatorStats startStats = simulator.stats();
+    IntervalStatsWriter intervalStats;
+    if (statsInterval > 0 && !intervalStats.open(statsPath, simulator.config(), startStats))
     {
-        runMulticoreSimulation();
+        cerr << "Error: Could not open stats file " << statsPath << endl;
+        releaseTraces();
+        return 1;
     }
 
-    // Cleanup allocated memory
-    auto cleanupIt = processorTrace0.begin();
-    while (cleanupIt != processorTrace0.end())
+    if (!checkpointPath.empty())
     {
-        delete[] cleanupIt->second;
-        cleanupIt++;
+        if (checkpointCycle >= 0)
+        {
+            simulator.step(checkpointCycle);
+        }
+        else
+        {
+            simulator.stepAccesses(checkpointAccesses);
+        }
+        if (!simulator.saveCheckpoint(checkpointPath))
+        {
+            cerr << "Error: Could not write checkpoint " << checkpointPath << endl;
+            releaseTraces();
+            return 1;
+        }
     }
-    cleanupIt = processorTrace1.begin();
-    while (cleanupIt != processorTrace1.end())
+
+    if (statsInterval > 0)
     {
-        delete[] cleanupIt->second;
-        cleanupIt++;
+        // Stop at every multiple of the interval; the engine runs as usual in
+        // between and only the records cost anything
+        intervalStats.writeInterval(simulator.stats());
+        bool active = true;
+        while (active)
+        {
+            long long clock = simulator.stats().clock;
+            active = simulator.step(statsInterval - clock % statsInterval);
+            intervalStats.writeInterval(simulator.stats());
+        }
+        if (!intervalStats.writeSummary(simulator.stats()))
+        {
+            cerr << "Error: Could not write stats file " << statsPath << endl;
+            releaseTraces();
+            return 1;
+        }
     }
-    cleanupIt = processorTrace2.begin();
-    while (cleanupIt != processorTrace2.end())
+
+    simulator.run();
+    auto reportStart = chrono::steady_clock::now();
+    simulator.printReport(outputFilename.empty() ? cout : outputFile);
+    if (outputFilename.empty())
     {
-        delete[] cleanupIt->second;
-        cleanupIt++;
+        cout.flush();
     }
-    cleanupIt = processorTrace3.begin();
-    while (cleanupIt != processorTrace3.end())
+    else
     {
-        delete[] cleanupIt->second;
-        cleanupIt++;
+        outputFile.flush();
     }
+    double reportSeconds = chrono::duration<double>(chrono::steady_clock::now() - reportStart).count();
+    printHostProfile(loadSeconds, reportSeconds, startStats, simulator.stats(), simulator.config());
 
+    releaseTraces();
     return 0;
 }
@@ -3,84 +3,240 @@
 
 #include <vector>
 #include <utility>
+#include <cstdlib>
+#include <cstring>
+#include "simd.hpp"
 
 using namespace std;
 
-// Configuration parameters for cache simulation
-extern int numSetBits;      // Number of set index bits: total sets = 2^numSetBits
-extern int numBlockBits;    // Number of block offset bits: block size = 2^numBlockBits bytes
-extern int associativity;   // Number of lines per set (E-way associativity)
+// Sharer bit masks are 64 bits wide, which bounds the core count
+const int MAX_CORES = 64;
 
-// Memory trace inputs for quad-core processor
-extern vector<pair<char, const char *>> processorTrace0;
-extern vector<pair<char, const char *>> processorTrace1;
-extern vector<pair<char, const char *>> processorTrace2;
-extern vector<pair<char, const char *>> processorTrace3;
+// Cache line replacement policy (-r); implementations in replacement.hpp
+enum class ReplacementPolicy
+{
+    LRU,        // True LRU (age counters)
+    PLRU,       // Tree pseudo-LRU
+    SRRIP,      // Static re-reference interval prediction
+    BRRIP,      // Bimodal re-reference interval prediction
+    NRU,        // Not recently used
+    RANDOM      // Random victim
+};
+
+// How the shared last-level cache (--llc) relates to the L1s; see llc.hpp
+enum class LlcInclusion
+{
+    INCLUSIVE,  // Holds every block an L1 holds; its evictions invalidate L1 copies
+    EXCLUSIVE,  // Holds only blocks no L1 holds: L1 victims, handed back on a hit
+    NINE        // Non-inclusive non-exclusive: fills allocate, evictions leave L1s alone
+};
+
+// Packed trace entry, identical in memory and in binary trace files:
+// bit 63 is the write flag, bits 0..62 hold the address
+typedef unsigned long long PackedTraceEntry;
+const PackedTraceEntry TRACE_WRITE_FLAG = 1ULL << 63;
+
+// Decoded trace entry: set index / tag precomputed for the configured s and b
+struct TraceRecord
+{
+    unsigned long long address;     // Memory address from trace
+    unsigned long long tagBits;     // Tag = address >> (s + b)
+    unsigned int setIndex : 31;     // Set index = (address >> b) & (S - 1)
+    unsigned int isWrite : 1;       // 1 for 'W', 0 for 'R'
+};
+
+// Read-only view of one core's packed trace (owned vector or mapped file)
+struct TraceView
+{
+    const PackedTraceEntry *entries;
+    size_t length;
+};
+
+// Decode a packed entry for a cache with setBits/blockBits index fields
+inline TraceRecord decodeTraceEntry(PackedTraceEntry entry, int setBits, int blockBits)
+{
+    unsigned long long address = entry & ~TRACE_WRITE_FLAG;
+
+    TraceRecord record;
+    record.address = address;
+    record.tagBits = address >> (setBits + blockBits);
+    record.setIndex = (address >> blockBits) & ((1ULL << setBits) - 1);
+    record.isWrite = (entry & TRACE_WRITE_FLAG) != 0;
+    return record;
+}
+
+enum class CoherenceState : unsigned char
+{
+    MODIFIED,
+    EXCLUSIVE,
+    SHARED,
+    INVALID
+};
 
-// Cache structure for each processor core
+// Cache structure for each processor core. All sets live in one cache-line
+// aligned block; each set is laid out contiguously as
+//   [tags: E x tagBytes][MESI state: E][dirty: E][replacement state: E]
+// padded so that a set never straddles more cache lines than it needs. Tags
+// are 4 bytes unless the traces' addresses leave more than 32 tag bits.
 struct CacheUnit
 {
     int totalSets;          // Number of sets = 2^numSetBits
     int bytesPerBlock;      // Block size = 2^numBlockBits bytes
     bool isStalled;
-    vector<vector<unsigned int>> tagArray;      // Tag storage [set][line]
-    vector<vector<bool>> validBits;             // Valid bits [set][line]
-    vector<vector<int>> lruOrder;               // LRU ordering [set] holds line indices
-    vector<vector<bool>> dirtyFlags;            // Dirty bits [set][line]
+    int waysPerSet;         // Associativity the storage was sized for
+    int tagBytes;           // 4 or 8 bytes per stored tag
+    size_t setStride;       // Bytes per set in storage
+    unsigned char *storage; // Aligned per-set metadata block
+    unsigned int randomState;   // Generator for random/bimodal replacement
+
+    CacheUnit() : totalSets(0), bytesPerBlock(0), isStalled(false), waysPerSet(0), tagBytes(4), setStride(0), storage(nullptr), randomState(1) {}
+    ~CacheUnit() { free(storage); }
+    CacheUnit(const CacheUnit &) = delete;
+    CacheUnit &operator=(const CacheUnit &) = delete;
+
+    // Per-set views into storage
+    unsigned char *tagsOf(int setIndex) { return storage + setIndex * setStride; }
+    CoherenceState *statesOf(int setIndex) { return (CoherenceState *)(tagsOf(setIndex) + waysPerSet * tagBytes); }
+    unsigned char *dirtyOf(int setIndex) { return (unsigned char *)statesOf(setIndex) + waysPerSet; }
+    unsigned char *replOf(int setIndex) { return dirtyOf(setIndex) + waysPerSet; }
 
-    // Initialize cache based on global parameters
-    void initialize()
+    // xorshift32 step
+    unsigned int nextRandom()
     {
-        totalSets = 1 << numSetBits;
-        bytesPerBlock = 1 << numBlockBits;
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 17;
+        randomState ^= randomState << 5;
+        return randomState;
+    }
 
-        // Allocate and initialize cache structures
-        tagArray.assign(totalSets, vector<unsigned int>(associativity, 0));
-        validBits.assign(totalSets, vector<bool>(associativity, false));
-        dirtyFlags.assign(totalSets, vector<bool>(associativity, false));
+    unsigned long long tagAt(int setIndex, int way)
+    {
+        if (tagBytes == 4)
+        {
+            return ((unsigned int *)tagsOf(setIndex))[way];
+        }
+        return ((unsigned long long *)tagsOf(setIndex))[way];
+    }
 
-        // Initialize LRU ordering for each set
-        lruOrder.clear();
-        lruOrder.resize(totalSets);
-        int setIdx = 0;
-        while (setIdx < totalSets)
+    void setTag(int setIndex, int way, unsigned long long tag)
+    {
+        if (tagBytes == 4)
+        {
+            ((unsigned int *)tagsOf(setIndex))[way] = (unsigned int)tag;
+        }
+        else
+        {
+            ((unsigned long long *)tagsOf(setIndex))[way] = tag;
+        }
+    }
+
+    // Valid ways holding tag among up to 64 ways starting at firstWay
+    WayMask matchWays(int setIndex, unsigned long long tag, int firstWay = 0)
+    {
+        int count = waysPerSet - firstWay < 64 ? waysPerSet - firstWay : 64;
+        const unsigned char *states = (const unsigned char *)statesOf(setIndex) + firstWay;
+        if (tagBytes == 4)
+        {
+            return matchTags((const unsigned int *)tagsOf(setIndex) + firstWay, states, (unsigned int)tag,
+                             (unsigned char)CoherenceState::INVALID, count);
+        }
+        return matchWideTags((const unsigned long long *)tagsOf(setIndex) + firstWay, states, tag,
+                             (unsigned char)CoherenceState::INVALID, count);
+    }
+
+    // First way of a set in the given coherence state, or -1
+    int findState(int setIndex, CoherenceState state)
+    {
+        const unsigned char *states = (const unsigned char *)statesOf(setIndex);
+        int firstWay = 0;
+        while (firstWay < waysPerSet)
+        {
+            int count = waysPerSet - firstWay < 64 ? waysPerSet - firstWay : 64;
+            WayMask hits = matchStates(states + firstWay, (unsigned char)state, count);
+            if (hits != 0)
+            {
+                return firstWay + __builtin_ctzll(hits);
+            }
+            firstWay += 64;
+        }
+        return -1;
+    }
+
+    // Call visit(way) for every valid way holding tag, in way order
+    template <class Visitor>
+    void forEachMatchingWay(int setIndex, unsigned long long tag, Visitor &&visit)
+    {
+        int firstWay = 0;
+        while (firstWay < waysPerSet)
+        {
+            WayMask hits = matchWays(setIndex, tag, firstWay);
+            while (hits != 0)
+            {
+                visit(firstWay + __builtin_ctzll(hits));
+                hits &= hits - 1;
+            }
+            firstWay += 64;
+        }
+    }
+
+    // Way holding a valid copy of tag in a set, or -1
+    int findWay(int setIndex, unsigned long long tag)
+    {
+        int firstWay = 0;
+        while (firstWay < waysPerSet)
         {
-            lruOrder[setIdx].clear();
-            int lineIdx = 0;
-            while (lineIdx < associativity)
+            WayMask hits = matchWays(setIndex, tag, firstWay);
+            if (hits != 0)
             {
-                lruOrder[setIdx].push_back(lineIdx);
-                lineIdx++;
+                return firstWay + __builtin_ctzll(hits);
             }
+            firstWay += 64;
+        }
+        return -1;
+    }
+
+    // Initialize cache for 2^setBits sets of ways lines of 2^blockBits bytes
+    // with tags of tagSize bytes; replacement state is reset separately by
+    // initializeReplacement()
+    void initialize(int setBits, int blockBits, int ways, int tagSize, unsigned int randomSeed)
+    {
+        totalSets = 1 << setBits;
+        bytesPerBlock = 1 << blockBits;
+        waysPerSet = ways;
+        tagBytes = tagSize;
+
+        // Round small sets up to a power of two so they pack evenly into
+        // 64-byte lines, larger ones up to a whole number of lines
+        size_t setBytes = ways * (tagBytes + 3);
+        setStride = 8;
+        while (setStride < setBytes && setStride < 64)
+        {
+            setStride <<= 1;
+        }
+        setStride = (setBytes + setStride - 1) / setStride * setStride;
+
+        // One spare line at the end for SIMD tag matching reading past the last set
+        size_t totalBytes = ((size_t)totalSets * setStride + 63) / 64 * 64 + 64;
+        free(storage);
+        storage = (unsigned char *)aligned_alloc(64, totalBytes);
+        memset(storage, 0, totalBytes);
+        randomState = randomSeed;
+
+        // All lines start invalid
+        int setIdx = 0;
+        while (setIdx < totalSets)
+        {
+            memset(statesOf(setIdx), (int)CoherenceState::INVALID, ways);
             setIdx++;
         }
     }
 };
 
-extern CacheUnit processorCaches[4];
-
-enum class CoherenceState
+// Cycle counts at the end of a run
+struct SimulationTiming
 {
-    MODIFIED,
-    EXCLUSIVE,
-    SHARED,
-    INVALID
+    long long simulationCycles; // Cycles until every core and the bus finished
+    long long peakCycles;       // Maximum execution time
 };
-extern vector<vector<CoherenceState>> coherenceTable[4];
-
-extern vector<int> executedInstructions;
-extern vector<int> totalCycles;
-
-extern vector<int> readCount;
-extern vector<int> writeCount;
-extern vector<int> missCount;
-extern vector<int> evictionCount;
-extern vector<int> writebackCount;
-extern vector<int> invalidationCount;
-extern vector<long long> trafficBytes;
-extern vector<int> stalledCycles;
-extern int busTransactionCount;
-extern long long totalBusTraffic;
-
-extern vector<bool> processorRunning;
+
 #endif // MAIN_HPP
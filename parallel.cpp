@@ -0,0 +1,317 @@
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include "main.hpp"
+#include "bus.hpp"
+#include "cache.hpp"
+#include "trace.hpp"
+#include "parallel.hpp"
+#include "state.hpp"
+
+using namespace std;
+
+// Run the free cores of one group ahead by up to quantumCycles accesses,
+// stopping each at its first bus access. Group g holds cores g, g + n, ...
+// Only the cores' own caches and run-ahead state are touched.
+static void runAheadGroup(int groupId, int groupCount)
+{
+    CacheUnit *caches = sim->processorCaches;
+    vector<QuantumCore> &cores = sim->quantumCores;
+    int coreId = groupId;
+    while (coreId < sim->numCores)
+    {
+        QuantumCore &core = cores[coreId];
+        bool isFree = !core.fetchedAll && !core.hasExecuting && !caches[coreId].isStalled &&
+                      core.replayed == core.steps.size();
+        if (isFree)
+        {
+            core.steps.clear();
+            core.replayed = 0;
+            while ((int)core.steps.size() < sim->quantumCycles)
+            {
+                TraceRecord entry = decodeTraceEntry(core.cursor.current());
+                RunAheadStep step;
+                step.address = entry.address;
+                step.reqType = BusRequestType::READ_SHARED;
+                step.isWrite = entry.isWrite;
+                step.needsBus = applyLocalAccess(caches[coreId], entry, step.reqType);
+                step.lastEntry = !core.cursor.advance();
+                core.steps.push_back(step);
+
+                if (step.lastEntry)
+                {
+                    core.fetchedAll = true;
+                    break;
+                }
+                if (step.needsBus)
+                {
+                    break;
+                }
+            }
+        }
+        coreId += groupCount;
+    }
+}
+
+// Cycles from now in which nothing but the bus countdown happens: every
+// running core waits on the bus or has nothing left to replay until the
+// next run-ahead. Idle cores must not be carried past the quantum end.
+static int idleReplayCycles(int cyclesLeft, int &idleCores)
+{
+    const vector<QuantumCore> &cores = sim->quantumCores;
+    idleCores = 0;
+    int procId = 0;
+    while (procId < sim->numCores)
+    {
+        if (sim->processorRunning[procId] && !isWaitingOnBus(procId))
+        {
+            if (cores[procId].replayed < cores[procId].steps.size() || sim->processorCaches[procId].isStalled)
+            {
+                return 0;
+            }
+            idleCores++;
+        }
+        procId++;
+    }
+    int busCycles = cyclesUntilBusEvent();
+    return idleCores > 0 ? min(busCycles, cyclesLeft - 1) : busCycles;
+}
+
+// One cycle of the serial engine, with each free core's access taken from
+// its run-ahead steps instead of a fresh cache lookup
+static void replayCycle()
+{
+    vector<QuantumCore> &cores = sim->quantumCores;
+    int procId = 0;
+    while (procId < sim->numCores)
+    {
+        QuantumCore &core = cores[procId];
+        if (!sim->processorRunning[procId])
+        {
+            procId++;
+            continue;
+        }
+
+        if (sim->processorCaches[procId].isStalled)
+        {
+            // Waiting on the bus: the access only counts the cycle
+            skipWaitingCycles(procId, 1);
+        }
+        else if (core.replayed < core.steps.size())
+        {
+            core.executing = core.steps[core.replayed++];
+            core.hasExecuting = true;
+            if (core.executing.needsBus)
+            {
+                issueBusRequest(procId, core.executing.address, core.executing.reqType);
+            }
+        }
+        else
+        {
+            // Free again before the quantum ends; resumes at the next run-ahead
+            sim->quantumSlipCycles++;
+        }
+        procId++;
+    }
+
+    processBusTransactions();
+
+    // A snoop that reaches a core with steps still to replay acted after the
+    // core had already used the line
+    unsigned long long snooped = sim->snoopedCoreMask;
+    sim->snoopedCoreMask = 0;
+    while (snooped != 0)
+    {
+        int snoopedCore = __builtin_ctzll(snooped);
+        snooped &= snooped - 1;
+        if (cores[snoopedCore].replayed < cores[snoopedCore].steps.size())
+        {
+            sim->runAheadConflicts++;
+        }
+    }
+
+    // Retire the executed access of every core that is not stalled
+    int retireIdx = 0;
+    while (retireIdx < sim->numCores)
+    {
+        QuantumCore &core = cores[retireIdx];
+        if (sim->processorRunning[retireIdx] && !sim->processorCaches[retireIdx].isStalled && core.hasExecuting)
+        {
+            core.hasExecuting = false;
+            sim->executedInstructions[retireIdx]++;
+            if (core.executing.isWrite)
+            {
+                sim->writeCount[retireIdx]++;
+            }
+            else
+            {
+                sim->readCount[retireIdx]++;
+            }
+            if (core.executing.lastEntry)
+            {
+                sim->processorRunning[retireIdx] = false;
+            }
+        }
+        retireIdx++;
+    }
+}
+
+// Spin-waits longer than this many yields go to sleep
+static const int BARRIER_SPIN_LIMIT = 1000;
+
+void QuantumBarrier::wait()
+{
+    unsigned int waitGeneration = generation.load(memory_order_acquire);
+    if (arrived.fetch_add(1, memory_order_acq_rel) + 1 == parties)
+    {
+        arrived.store(0, memory_order_relaxed);
+        generation.fetch_add(1, memory_order_seq_cst);
+        if (sleepers.load(memory_order_seq_cst) > 0)
+        {
+            lock_guard<mutex> guard(sleepLock);
+            sleepSignal.notify_all();
+        }
+        return;
+    }
+    int spins = 0;
+    while (generation.load(memory_order_acquire) == waitGeneration)
+    {
+        if (spins++ < BARRIER_SPIN_LIMIT)
+        {
+            this_thread::yield();
+            continue;
+        }
+        unique_lock<mutex> guard(sleepLock);
+        sleepers.fetch_add(1, memory_order_seq_cst);
+        while (generation.load(memory_order_seq_cst) == waitGeneration)
+        {
+            sleepSignal.wait(guard);
+        }
+        sleepers.fetch_sub(1, memory_order_relaxed);
+    }
+}
+
+QuantumWorkerPool::QuantumWorkerPool(SimulationState *state, int groupCount)
+    : groupCount(groupCount), runAheadStart(groupCount), runAheadDone(groupCount), stopping(false)
+{
+    // Workers bind the simulation for good and run ahead on its caches
+    auto worker = [this, state](int groupId) {
+        SimulationBinding binding(state);
+        while (true)
+        {
+            runAheadStart.wait();
+            if (stopping)
+            {
+                return;
+            }
+            runAheadGroup(groupId, this->groupCount);
+            runAheadDone.wait();
+        }
+    };
+    int groupIdx = 1;
+    while (groupIdx < groupCount)
+    {
+        workers.emplace_back(worker, groupIdx);
+        groupIdx++;
+    }
+}
+
+QuantumWorkerPool::~QuantumWorkerPool()
+{
+    // Release the workers waiting for another run-ahead
+    stopping = true;
+    runAheadStart.wait();
+    for (thread &workerThread : workers)
+    {
+        workerThread.join();
+    }
+}
+
+void QuantumWorkerPool::runAhead()
+{
+    runAheadStart.wait();
+    runAheadGroup(0, groupCount);
+    runAheadDone.wait();
+}
+
+void beginQuantumSimulation()
+{
+    sim->quantumCores.assign(sim->numCores, QuantumCore());
+    int openIdx = 0;
+    while (openIdx < sim->numCores)
+    {
+        QuantumCore &core = sim->quantumCores[openIdx];
+        core.cursor = sim->traceCursor[openIdx];
+        core.steps.reserve(sim->quantumCycles);
+        core.replayed = 0;
+        core.hasExecuting = false;
+        core.fetchedAll = !core.cursor.hasEntry();
+        sim->processorRunning[openIdx] = !core.fetchedAll;
+        openIdx++;
+    }
+}
+
+bool advanceQuantumSimulation(long long targetCycle)
+{
+    // This thread drives group 0 and the replay
+    if (!sim->quantumWorkers)
+    {
+        sim->quantumWorkers.reset(new QuantumWorkerPool(sim, min(sim->parallelThreads, sim->numCores)));
+    }
+
+    while (sim->simulationActive && sim->currentCycle < targetCycle)
+    {
+        sim->quantumWorkers->runAhead();
+
+        // Replay the quantum cycle by cycle on this thread
+        long long quantumEnd = sim->currentCycle + sim->quantumCycles;
+        while (sim->simulationActive && sim->currentCycle < quantumEnd)
+        {
+            // Event-driven mode: jump to the next cycle where state changes
+            if (sim->eventDrivenClock)
+            {
+                int idleCores;
+                int idleCycles = idleReplayCycles((int)(quantumEnd - sim->currentCycle), idleCores);
+                if (idleCycles > 0)
+                {
+                    int skipIdx = 0;
+                    while (skipIdx < sim->numCores)
+                    {
+                        if (sim->processorRunning[skipIdx] && isWaitingOnBus(skipIdx))
+                        {
+                            skipWaitingCycles(skipIdx, idleCycles);
+                        }
+                        skipIdx++;
+                    }
+                    skipBusCycles(idleCycles);
+                    sim->quantumSlipCycles += (long long)idleCores * idleCycles;
+                    sim->currentCycle += idleCycles;
+                    sim->peakCycles = max(sim->peakCycles, sim->currentCycle);
+                }
+            }
+
+            replayCycle();
+
+            // Check if simulation should continue
+            sim->simulationActive = !sim->dataTransferQueue.empty();
+            int checkIdx = 0;
+            while (checkIdx < sim->numCores && !sim->simulationActive)
+            {
+                sim->simulationActive = sim->processorRunning[checkIdx] || sim->processorCaches[checkIdx].isStalled;
+                checkIdx++;
+            }
+
+            sim->currentCycle++;
+            sim->peakCycles = max(sim->peakCycles, sim->currentCycle);
+        }
+    }
+
+    if (!sim->simulationActive)
+    {
+        sim->quantumWorkers.reset();
+    }
+    return sim->simulationActive;
+}
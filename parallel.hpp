@@ -0,0 +1,102 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "main.hpp"
+#include "bus.hpp"
+#include "trace.hpp"
+
+using namespace std;
+
+// Parallel quantum engine (--parallel). Host threads own fixed groups of
+// cores and, once per quantum, run each free core ahead on its own cache:
+// hits are applied and the first access that needs the bus ends the run.
+// The calling thread then replays the quantum cycle by cycle, issuing the
+// recorded bus requests in core order and driving the shared bus, so the
+// bus and every coherence action stay deterministic.
+//
+// A quantum of 1 cycle reproduces the serial engine exactly. Longer quanta
+// trade accuracy for fewer barriers: a core's run-ahead hits ignore snoops
+// that arrive later in the same quantum, and a core whose miss completes
+// mid-quantum idles until the next one. Both are counted and reported.
+
+// One access a core ran ahead with. Hits are already applied to its cache;
+// a bus access is issued when the replay reaches it.
+struct RunAheadStep
+{
+    unsigned long long address; // Memory address of the access
+    BusRequestType reqType;     // Request to issue if needsBus
+    bool needsBus;              // Miss or upgrade
+    bool isWrite;               // Counted as a write when it retires
+    bool lastEntry;             // Retiring it finishes the core's trace
+};
+
+// Run-ahead state of one simulated core, padded so that cores driven by
+// different threads never share a cache line
+struct alignas(64) QuantumCore
+{
+    TraceCursor cursor;             // Next entry to run ahead with
+    vector<RunAheadStep> steps;     // Recorded in the last run-ahead
+    size_t replayed;                // Steps already handed to the replay
+    RunAheadStep executing;         // Replayed step that has not retired yet
+    bool hasExecuting;
+    bool fetchedAll;                // Every trace entry has been recorded
+};
+
+struct SimulationState;
+
+// Barrier for a fixed group of threads, reusable across quanta. Waiters
+// spin with yields, since a quantum is much shorter than a sleep and
+// wakeup, and only sleep once the wait has gone on much longer than that,
+// e.g. while the simulation sits between step() calls.
+class QuantumBarrier
+{
+public:
+    explicit QuantumBarrier(int threadCount) : parties(threadCount), arrived(0), generation(0), sleepers(0) {}
+    void wait();
+
+private:
+    int parties;
+    atomic<int> arrived;
+    atomic<unsigned int> generation;
+    atomic<int> sleepers;
+    mutex sleepLock;
+    condition_variable sleepSignal;
+};
+
+// Host threads that run every core group but the calling thread's ahead.
+// One pool serves a simulation's whole run, across quanta and step()
+// calls; destroying it stops and joins the threads.
+class QuantumWorkerPool
+{
+public:
+    QuantumWorkerPool(SimulationState *state, int groupCount);
+    ~QuantumWorkerPool();
+    QuantumWorkerPool(const QuantumWorkerPool &) = delete;
+    QuantumWorkerPool &operator=(const QuantumWorkerPool &) = delete;
+
+    // Run every group ahead, group 0 on the calling thread, and return once
+    // all of them are done
+    void runAhead();
+
+private:
+    int groupCount;
+    QuantumBarrier runAheadStart;
+    QuantumBarrier runAheadDone;
+    bool stopping;
+    vector<thread> workers;
+};
+
+// Hand the bound simulation's opened trace cursors to the parallel engine
+void beginQuantumSimulation();
+
+// Run quanta on the bound simulation until its clock reaches targetCycle or
+// every core has finished; false once finished. The simulation's worker
+// pool is started on first use and released when the run finishes.
+bool advanceQuantumSimulation(long long targetCycle);
+
+#endif // PARALLEL_HPP
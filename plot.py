@@ -4,9 +4,10 @@ Generates performance graphs for multicore cache simulator experiments.
 """
 
 import subprocess
-import re
 import os
 import sys
+import csv
+import tempfile
 
 # Optional imports with fallback
 try:
@@ -25,55 +26,48 @@ class CacheExperiment:
         self.simulator = simulator_path
         self.trace = trace_name
         self.collected_data = []
+        self.queued_configs = []
         
-    def execute_sim(self, set_bits, ways, block_bits, label="default"):
+    def queue_sim(self, set_bits, ways, block_bits, label="default"):
+        """Record a configuration for the next run_queued() sweep."""
+        self.queued_configs.append((set_bits, ways, block_bits, label))
+
+    def run_queued(self):
         """
-        Run a single simulation with given parameters.
-        Returns dict with results or None on failure.
+        Simulate all queued configurations in one --sweep process, which loads
+        the traces once and runs the points on all host cores.
         """
-        cache_bytes = (1 << set_bits) * ways * (1 << block_bits)
-        
-        args = [
-            self.simulator,
-            "-t", self.trace,
-            "-s", str(set_bits),
-            "-E", str(ways),
-            "-b", str(block_bits)
-        ]
-        
-        print(f"  [{label}] s={set_bits}, E={ways}, b={block_bits} -> {cache_bytes} bytes")
-        
+        if not self.queued_configs:
+            return
+        with tempfile.NamedTemporaryFile("w", suffix=".sweep", delete=False) as spec:
+            for set_bits, ways, block_bits, _ in self.queued_configs:
+                spec.write(f"{set_bits} {ways} {block_bits}\n")
+            spec_path = spec.name
+
+        print(f"  Sweeping {len(self.queued_configs)} configurations...")
         try:
-            proc = subprocess.run(args, capture_output=True, text=True, timeout=300)
-            
-            if proc.returncode != 0:
-                print(f"    ERROR: Simulation returned {proc.returncode}")
-                return None
-            
-            # Parse execution time from output
-            time_match = re.search(r"Maximum Execution Time.*?(\d+)", proc.stdout)
-            if time_match is None:
-                print("    ERROR: Could not parse execution time")
-                return None
-            
-            exec_time = int(time_match.group(1))
-            
-            return {
+            proc = subprocess.run([self.simulator, "-t", self.trace, "--sweep", "@" + spec_path],
+                                  capture_output=True, text=True)
+        finally:
+            os.unlink(spec_path)
+        if proc.returncode != 0:
+            print(f"    ERROR: Sweep returned {proc.returncode}: {proc.stderr.strip()}")
+            self.queued_configs = []
+            return
+
+        # Table rows come back in the order the configurations were listed
+        rows = list(csv.DictReader(proc.stdout.splitlines()))
+        for (set_bits, ways, block_bits, label), row in zip(self.queued_configs, rows):
+            self.add_result({
                 "experiment": label,
                 "s": set_bits,
                 "E": ways,
                 "b": block_bits,
-                "cache_size": cache_bytes,
-                "exec_cycles": exec_time
-            }
-            
-        except subprocess.TimeoutExpired:
-            print("    ERROR: Simulation timed out")
-            return None
-        except Exception as err:
-            print(f"    ERROR: {err}")
-            return None
-    
+                "cache_size": int(row["cache_bytes"]),
+                "exec_cycles": int(row["max_exec_cycles"])
+            })
+        self.queued_configs = []
+
     def add_result(self, data):
         """Store a simulation result."""
         if data is not None:
@@ -213,8 +207,7 @@ def run_experiments():
     print("\n[Experiment 1] Varying set index bits...")
     s_val = 2
     while s_val <= 10:
-        res = exp.execute_sim(s_val, BASE_E, BASE_B, "vary_s")
-        exp.add_result(res)
+        exp.queue_sim(s_val, BASE_E, BASE_B, "vary_s")
         s_val += 1
     
     # ----- Experiment 2: Vary associativity (E) -----
@@ -222,16 +215,14 @@ def run_experiments():
     e_list = [1, 2, 4, 8, 16, 32, 64]
     e_idx = 0
     while e_idx < len(e_list):
-        res = exp.execute_sim(BASE_S, e_list[e_idx], BASE_B, "vary_E")
-        exp.add_result(res)
+        exp.queue_sim(BASE_S, e_list[e_idx], BASE_B, "vary_E")
         e_idx += 1
     
     # ----- Experiment 3: Vary block size (b) -----
     print("\n[Experiment 3] Varying block bits...")
     b_val = 3
     while b_val <= 8:
-        res = exp.execute_sim(BASE_S, BASE_E, b_val, "vary_b")
-        exp.add_result(res)
+        exp.queue_sim(BASE_S, BASE_E, b_val, "vary_b")
         b_val += 1
     
     # ----- Experiment 4: Constant cache, vary s and b -----
@@ -247,8 +238,7 @@ def run_experiments():
     cfg_idx = 0
     while cfg_idx < len(const_sb_configs):
         s, e, b = const_sb_configs[cfg_idx]
-        res = exp.execute_sim(s, e, b, "const_cache_sb")
-        exp.add_result(res)
+        exp.queue_sim(s, e, b, "const_cache_sb")
         cfg_idx += 1
     
     # ----- Experiment 5: Constant cache, vary E and b -----
@@ -262,8 +252,7 @@ def run_experiments():
     cfg_idx = 0
     while cfg_idx < len(const_eb_configs):
         s, e, b = const_eb_configs[cfg_idx]
-        res = exp.execute_sim(s, e, b, "const_cache_eb")
-        exp.add_result(res)
+        exp.queue_sim(s, e, b, "const_cache_eb")
         cfg_idx += 1
     
     # ----- Experiment 6: Constant cache, vary s and E -----
@@ -278,10 +267,12 @@ def run_experiments():
     cfg_idx = 0
     while cfg_idx < len(const_se_configs):
         s, e, b = const_se_configs[cfg_idx]
-        res = exp.execute_sim(s, e, b, "const_cache_se")
-        exp.add_result(res)
+        exp.queue_sim(s, e, b, "const_cache_se")
         cfg_idx += 1
     
+    # Run every queued configuration in one sweep
+    exp.run_queued()
+
     # Export data
     print("\n" + "-" * 50)
     exp.export_csv(OUTPUT_CSV)
@@ -0,0 +1,49 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <chrono>
+#include "simulator.hpp"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+
+// Host cycle counter: the timestamp counter on x86, nanoseconds elsewhere
+inline unsigned long long readHostTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Adds the host ticks of its scope to one phase of a profile
+class ScopedHostTimer
+{
+public:
+    ScopedHostTimer(HostProfile &profile, HostPhase phase) : profile(profile), phase((int)phase), start(readHostTicks()) {}
+    ~ScopedHostTimer()
+    {
+        profile.phaseTicks[phase] += readHostTicks() - start;
+        profile.phaseCalls[phase]++;
+    }
+    ScopedHostTimer(const ScopedHostTimer &) = delete;
+    ScopedHostTimer &operator=(const ScopedHostTimer &) = delete;
+
+private:
+    HostProfile &profile;
+    int phase;
+    unsigned long long start;
+};
+
+// Time the rest of the enclosing scope as a phase of the bound simulation.
+// Only builds with L1SIM_PROFILE (make PROFILE=1) keep the timers.
+#ifdef L1SIM_PROFILE
+#define PROFILE_SCOPE(phase) ScopedHostTimer hostPhaseTimer(sim->hostProfile, phase)
+#else
+#define PROFILE_SCOPE(phase)
+#endif
+
+#endif // PROFILE_HPP
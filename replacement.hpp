@@ -0,0 +1,235 @@
+#ifndef REPLACEMENT_HPP
+#define REPLACEMENT_HPP
+
+#include "main.hpp"
+
+// Replacement policies. Each policy keeps its per-set state in the E bytes
+// CacheUnit::replOf(set) returns and is used as a template parameter of the
+// cache engine in cache.cpp, so hits never go through an indirect call.
+//
+//   initSet(cache, set)         reset state for an empty set
+//   onHit(cache, set, way)      access to a resident line
+//   onFill(cache, set, way)     line installed by a miss
+//   victim(cache, set)          way to evict when the set is full
+
+// True LRU with per-way age counters: 0 is most recent, E-1 least recent
+struct LruPolicy
+{
+    static void initSet(CacheUnit &cache, int setIndex)
+    {
+        // Way 0 starts as the least recently used, matching fill order
+        unsigned char *ages = cache.replOf(setIndex);
+        int wayIdx = 0;
+        while (wayIdx < cache.waysPerSet)
+        {
+            ages[wayIdx] = cache.waysPerSet - 1 - wayIdx;
+            wayIdx++;
+        }
+    }
+
+    static void onHit(CacheUnit &cache, int setIndex, int wayIdx)
+    {
+        // Branch-free pass over E one-byte counters: lines younger than the
+        // touched one age by one, the touched one becomes youngest
+        unsigned char *ages = cache.replOf(setIndex);
+        unsigned char touchedAge = ages[wayIdx];
+        int ways = cache.waysPerSet;
+        for (int idx = 0; idx < ways; idx++)
+        {
+            ages[idx] += ages[idx] < touchedAge;
+        }
+        ages[wayIdx] = 0;
+    }
+
+    static void onFill(CacheUnit &cache, int setIndex, int wayIdx) { onHit(cache, setIndex, wayIdx); }
+
+    static int victim(CacheUnit &cache, int setIndex)
+    {
+        const unsigned char *ages = cache.replOf(setIndex);
+        int oldest = cache.waysPerSet - 1;
+        int wayIdx = 0;
+        while (ages[wayIdx] != oldest)
+        {
+            wayIdx++;
+        }
+        return wayIdx;
+    }
+};
+
+// Tree pseudo-LRU over a power-of-two number of ways. Node n (children 2n+1
+// and 2n+2) stores the direction of the less recently used half: 0 = left.
+struct TreePlruPolicy
+{
+    static void initSet(CacheUnit &cache, int setIndex)
+    {
+        memset(cache.replOf(setIndex), 0, cache.waysPerSet);
+    }
+
+    static void onHit(CacheUnit &cache, int setIndex, int wayIdx)
+    {
+        unsigned char *nodes = cache.replOf(setIndex);
+        int node = 0;
+        int span = cache.waysPerSet >> 1;
+        while (span > 0)
+        {
+            // Point away from the half that holds the touched way
+            bool goRight = (wayIdx & span) != 0;
+            nodes[node] = !goRight;
+            node = 2 * node + 1 + goRight;
+            span >>= 1;
+        }
+    }
+
+    static void onFill(CacheUnit &cache, int setIndex, int wayIdx) { onHit(cache, setIndex, wayIdx); }
+
+    static int victim(CacheUnit &cache, int setIndex)
+    {
+        const unsigned char *nodes = cache.replOf(setIndex);
+        int node = 0;
+        int wayIdx = 0;
+        int span = cache.waysPerSet >> 1;
+        while (span > 0)
+        {
+            bool goRight = nodes[node] != 0;
+            wayIdx |= goRight ? span : 0;
+            node = 2 * node + 1 + goRight;
+            span >>= 1;
+        }
+        return wayIdx;
+    }
+};
+
+// Static/bimodal re-reference interval prediction with 2-bit RRPVs
+const unsigned char RRPV_DISTANT = 3;
+
+template <bool Bimodal>
+struct RripPolicy
+{
+    static void initSet(CacheUnit &cache, int setIndex)
+    {
+        memset(cache.replOf(setIndex), RRPV_DISTANT, cache.waysPerSet);
+    }
+
+    static void onHit(CacheUnit &cache, int setIndex, int wayIdx)
+    {
+        cache.replOf(setIndex)[wayIdx] = 0;
+    }
+
+    static void onFill(CacheUnit &cache, int setIndex, int wayIdx)
+    {
+        // SRRIP inserts with a long re-reference interval; BRRIP inserts
+        // distant except for one fill in 32
+        unsigned char insertRrpv = RRPV_DISTANT - 1;
+        if (Bimodal && (cache.nextRandom() & 31) != 0)
+        {
+            insertRrpv = RRPV_DISTANT;
+        }
+        cache.replOf(setIndex)[wayIdx] = insertRrpv;
+    }
+
+    static int victim(CacheUnit &cache, int setIndex)
+    {
+        // Age every line by the amount the oldest needs to become distant,
+        // then take the first distant line
+        unsigned char *rrpv = cache.replOf(setIndex);
+        int ways = cache.waysPerSet;
+        unsigned char oldest = 0;
+        for (int idx = 0; idx < ways; idx++)
+        {
+            oldest = rrpv[idx] > oldest ? rrpv[idx] : oldest;
+        }
+        unsigned char ageBy = RRPV_DISTANT - oldest;
+        int victimWay = -1;
+        for (int idx = 0; idx < ways; idx++)
+        {
+            rrpv[idx] += ageBy;
+            if (victimWay == -1 && rrpv[idx] == RRPV_DISTANT)
+            {
+                victimWay = idx;
+            }
+        }
+        return victimWay;
+    }
+};
+
+typedef RripPolicy<false> SrripPolicy;
+typedef RripPolicy<true> BrripPolicy;
+
+// Not-recently-used: one reference bit per way, cleared for the other ways
+// once every way has been referenced
+struct NruPolicy
+{
+    static void initSet(CacheUnit &cache, int setIndex)
+    {
+        memset(cache.replOf(setIndex), 0, cache.waysPerSet);
+    }
+
+    static void onHit(CacheUnit &cache, int setIndex, int wayIdx)
+    {
+        unsigned char *referenced = cache.replOf(setIndex);
+        if (referenced[wayIdx])
+        {
+            return;
+        }
+        referenced[wayIdx] = 1;
+        int ways = cache.waysPerSet;
+        int referencedCount = 0;
+        for (int idx = 0; idx < ways; idx++)
+        {
+            referencedCount += referenced[idx];
+        }
+        if (referencedCount == ways)
+        {
+            memset(referenced, 0, ways);
+            referenced[wayIdx] = 1;
+        }
+    }
+
+    static void onFill(CacheUnit &cache, int setIndex, int wayIdx) { onHit(cache, setIndex, wayIdx); }
+
+    static int victim(CacheUnit &cache, int setIndex)
+    {
+        // A direct-mapped set stays referenced; its only way is the victim
+        const unsigned char *referenced = cache.replOf(setIndex);
+        int wayIdx = 0;
+        while (wayIdx < cache.waysPerSet && referenced[wayIdx])
+        {
+            wayIdx++;
+        }
+        return wayIdx < cache.waysPerSet ? wayIdx : 0;
+    }
+};
+
+// Uniform random victim from the cache's own deterministic generator
+struct RandomPolicy
+{
+    static void initSet(CacheUnit &, int) {}
+    static void onHit(CacheUnit &, int, int) {}
+    static void onFill(CacheUnit &, int, int) {}
+    static int victim(CacheUnit &cache, int) { return cache.nextRandom() % cache.waysPerSet; }
+};
+
+// Invoke visit(Policy()) for the policy selected at run time. The switch is
+// taken once per engine entry; everything below it is specialized.
+template <class Visitor>
+inline auto dispatchReplacement(ReplacementPolicy policy, Visitor &&visit)
+{
+    switch (policy)
+    {
+    case ReplacementPolicy::PLRU:
+        return visit(TreePlruPolicy());
+    case ReplacementPolicy::SRRIP:
+        return visit(SrripPolicy());
+    case ReplacementPolicy::BRRIP:
+        return visit(BrripPolicy());
+    case ReplacementPolicy::NRU:
+        return visit(NruPolicy());
+    case ReplacementPolicy::RANDOM:
+        return visit(RandomPolicy());
+    case ReplacementPolicy::LRU:
+    default:
+        return visit(LruPolicy());
+    }
+}
+
+#endif // REPLACEMENT_HPP
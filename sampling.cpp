@@ -0,0 +1,195 @@
+#include <vector>
+#include <cmath>
+#include <climits>
+#include <algorithm>
+#include "main.hpp"
+#include "trace.hpp"
+#include "state.hpp"
+#include "sampling.hpp"
+
+using namespace std;
+
+// Two-sided 95% quantile of the normal distribution. Sampling runs are meant
+// to have tens of units or more, where the normal approximation holds.
+static const double CONFIDENCE_Z = 1.96;
+
+template <class T>
+static long long sumOf(const vector<T> &values)
+{
+    long long total = 0;
+    for (T value : values)
+    {
+        total += value;
+    }
+    return total;
+}
+
+// Run the detailed engine until at least accesses accesses have retired in
+// all, stepping by no more cycles than could retire them
+static void advanceSerialUntilRetired(long long accesses)
+{
+    while (sim->simulationActive)
+    {
+        long long remaining = accesses - sumOf(sim->executedInstructions);
+        if (remaining <= 0)
+        {
+            break;
+        }
+        long long targetCycle = sim->currentCycle + max(1LL, remaining / sim->numCores);
+        advanceSerialSimulation(targetCycle);
+    }
+}
+
+// Warm, then run the detailed accesses of one unit and record its window
+static void runSampleUnit()
+{
+    int coreCount = sim->numCores;
+    vector<TraceCursor> &traceCursor = sim->traceCursor;
+    warmCaches(sim->samplePeriod - sim->sampleWarmup - sim->sampleWindow, sim->sampledAccesses);
+
+    // Cut every trace after the unit's detailed accesses
+    vector<TraceCursor> unlimited(traceCursor);
+    int activeCores = 0;
+    int coreIdx = 0;
+    while (coreIdx < coreCount)
+    {
+        limitTraceCursor(traceCursor[coreIdx], sim->sampleWarmup + sim->sampleWindow, sim->sampleLimits[coreIdx]);
+        sim->processorRunning[coreIdx] = traceCursor[coreIdx].hasEntry();
+        if (sim->processorRunning[coreIdx])
+        {
+            sim->currentOp[coreIdx] = decodeTraceEntry(traceCursor[coreIdx].current());
+            activeCores++;
+        }
+        coreIdx++;
+    }
+
+    resetCounters();
+    sim->currentCycle = 0;
+    sim->peakCycles = 0;
+    sim->simulationActive = activeCores > 0;
+
+    // Detailed warming refills the bus queues, then the window is measured
+    advanceSerialUntilRetired(sim->sampleWarmup * activeCores);
+    SampleUnit unit;
+    long long startCycle = sim->currentCycle;
+    long long startAccesses = sumOf(sim->executedInstructions);
+    long long startMisses = sumOf(sim->missCount);
+    long long startTraffic = sim->totalBusTraffic;
+    vector<long long> startCoreAccesses(sim->executedInstructions);
+    vector<long long> startCoreCycles(coreCount);
+    coreIdx = 0;
+    while (coreIdx < coreCount)
+    {
+        startCoreCycles[coreIdx] = sim->totalCycles[coreIdx] + sim->executedInstructions[coreIdx];
+        coreIdx++;
+    }
+
+    advanceSerialSimulation(LLONG_MAX);
+
+    unit.accesses = sumOf(sim->executedInstructions) - startAccesses;
+    unit.cycles = sim->currentCycle - startCycle;
+    unit.misses = sumOf(sim->missCount) - startMisses;
+    unit.busTraffic = sim->totalBusTraffic - startTraffic;
+    unit.coreAccesses.resize(coreCount);
+    unit.coreCycles.resize(coreCount);
+    coreIdx = 0;
+    while (coreIdx < coreCount)
+    {
+        unit.coreAccesses[coreIdx] = sim->executedInstructions[coreIdx] - startCoreAccesses[coreIdx];
+        unit.coreCycles[coreIdx] = sim->totalCycles[coreIdx] + sim->executedInstructions[coreIdx] - startCoreCycles[coreIdx];
+        coreIdx++;
+    }
+    if (unit.accesses > 0)
+    {
+        sim->samples.push_back(unit);
+    }
+
+    // Continue the traces past the cut
+    sim->simulationActive = false;
+    coreIdx = 0;
+    while (coreIdx < coreCount)
+    {
+        sim->sampledAccesses[coreIdx] += sim->executedInstructions[coreIdx];
+        unlimitTraceCursor(traceCursor[coreIdx], unlimited[coreIdx], sim->sampleLimits[coreIdx]);
+        sim->simulationActive = sim->simulationActive || traceCursor[coreIdx].hasEntry();
+        coreIdx++;
+    }
+}
+
+bool advanceSampledSimulation(long long targetUnits)
+{
+    while (sim->simulationActive && (long long)sim->samples.size() < targetUnits)
+    {
+        runSampleUnit();
+    }
+    return sim->simulationActive;
+}
+
+// Mean of per-unit ratios times scale, with its confidence interval
+static SampleEstimate estimateMean(const vector<double> &ratios, double scale)
+{
+    size_t count = ratios.size();
+    if (count == 0)
+    {
+        return SampleEstimate{0.0, -1.0};
+    }
+    double mean = 0.0;
+    for (double ratio : ratios)
+    {
+        mean += ratio;
+    }
+    mean /= count;
+    if (count < 2)
+    {
+        return SampleEstimate{mean * scale, -1.0};
+    }
+    double squares = 0.0;
+    for (double ratio : ratios)
+    {
+        squares += (ratio - mean) * (ratio - mean);
+    }
+    double halfWidth = CONFIDENCE_Z * sqrt(squares / (count - 1) / count);
+    return SampleEstimate{mean * scale, halfWidth * scale};
+}
+
+SamplingEstimates samplingEstimates()
+{
+    SamplingEstimates result;
+    result.units = (int)sim->samples.size();
+    result.measuredAccesses = 0;
+    result.totalAccesses = sumOf(sim->sampledAccesses);
+
+    // The cores share the clock, so a window's cycles per access of all
+    // cores scale with the accesses of all cores
+    vector<double> cycleRatios;
+    vector<double> missRatios;
+    vector<double> trafficRatios;
+    for (const SampleUnit &unit : sim->samples)
+    {
+        result.measuredAccesses += unit.accesses;
+        cycleRatios.push_back((double)unit.cycles / unit.accesses);
+        missRatios.push_back((double)unit.misses / unit.accesses);
+        trafficRatios.push_back((double)unit.busTraffic / unit.accesses);
+    }
+    result.simulationCycles = estimateMean(cycleRatios, (double)result.totalAccesses);
+    result.missRate = estimateMean(missRatios, 100.0);
+    result.busTraffic = estimateMean(trafficRatios, (double)result.totalAccesses);
+
+    // Execution cycles per access of each core, scaled by its accesses
+    result.coreCycles.resize(sim->numCores);
+    int coreIdx = 0;
+    while (coreIdx < sim->numCores)
+    {
+        vector<double> coreRatios;
+        for (const SampleUnit &unit : sim->samples)
+        {
+            if (unit.coreAccesses[coreIdx] > 0)
+            {
+                coreRatios.push_back((double)unit.coreCycles[coreIdx] / unit.coreAccesses[coreIdx]);
+            }
+        }
+        result.coreCycles[coreIdx] = estimateMean(coreRatios, (double)sim->sampledAccesses[coreIdx]);
+        coreIdx++;
+    }
+    return result;
+}
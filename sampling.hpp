@@ -0,0 +1,36 @@
+#ifndef SAMPLING_HPP
+#define SAMPLING_HPP
+
+#include <vector>
+#include "main.hpp"
+#include "simulator.hpp"
+
+using namespace std;
+
+// Sampled simulation (--sample), after SMARTS. The trace is cut into units
+// of samplePeriod accesses per core. In every unit the caches are first
+// warmed untimed, as in functional mode. The last sampleWarmup + sampleWindow
+// accesses of each core then run on the detailed serial engine. The first
+// sampleWarmup accesses (on average over the cores) refill the bus; only the
+// rest are measured. Each unit yields per-access ratios, whose means
+// estimate the full run and whose spread gives the confidence intervals.
+
+// Measurement window of one sampling unit
+struct SampleUnit
+{
+    long long accesses;             // Accesses retired in the window, all cores
+    long long cycles;               // Cycles the window took
+    long long misses;
+    long long busTraffic;           // Bytes
+    vector<long long> coreAccesses;
+    vector<long long> coreCycles;   // Execution cycles of each core in the window
+};
+
+// Run sampling units on the bound simulation until targetUnits have run or
+// the traces end; false once finished
+bool advanceSampledSimulation(long long targetUnits);
+
+// Extrapolate the bound simulation's sampling units to the whole region
+SamplingEstimates samplingEstimates();
+
+#endif // SAMPLING_HPP
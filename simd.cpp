@@ -0,0 +1,231 @@
+#include <string>
+#include <cstring>
+#include "simd.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+using namespace std;
+
+static WayMask matchTagsScalar(const unsigned int *tags, const unsigned char *states,
+                               unsigned int tag, unsigned char invalidState, int count)
+{
+    WayMask hits = 0;
+    int wayIdx = 0;
+    while (wayIdx < count)
+    {
+        hits |= (WayMask)(tags[wayIdx] == tag && states[wayIdx] != invalidState) << wayIdx;
+        wayIdx++;
+    }
+    return hits;
+}
+
+static WayMask matchWideTagsScalar(const unsigned long long *tags, const unsigned char *states,
+                                   unsigned long long tag, unsigned char invalidState, int count)
+{
+    WayMask hits = 0;
+    int wayIdx = 0;
+    while (wayIdx < count)
+    {
+        hits |= (WayMask)(tags[wayIdx] == tag && states[wayIdx] != invalidState) << wayIdx;
+        wayIdx++;
+    }
+    return hits;
+}
+
+static WayMask matchStatesScalar(const unsigned char *states, unsigned char state, int count)
+{
+    WayMask hits = 0;
+    int wayIdx = 0;
+    while (wayIdx < count)
+    {
+        hits |= (WayMask)(states[wayIdx] == state) << wayIdx;
+        wayIdx++;
+    }
+    return hits;
+}
+
+#ifdef HAVE_X86_SIMD
+// Four ways per step: 32-bit tag compares plus a byte compare on the states
+__attribute__((target("sse4.1")))
+static WayMask matchTagsSse4(const unsigned int *tags, const unsigned char *states,
+                             unsigned int tag, unsigned char invalidState, int count)
+{
+    __m128i probe = _mm_set1_epi32(tag);
+    __m128i invalid = _mm_set1_epi8(invalidState);
+    WayMask hits = 0;
+    int wayIdx = 0;
+    while (wayIdx < count)
+    {
+        __m128i tagLanes = _mm_loadu_si128((const __m128i *)(tags + wayIdx));
+        unsigned int tagBits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(tagLanes, probe)));
+        int stateWord;
+        memcpy(&stateWord, states + wayIdx, sizeof(stateWord));
+        unsigned int invalidBits = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_cvtsi32_si128(stateWord), invalid)) & 0xF;
+        hits |= (WayMask)(tagBits & ~invalidBits) << wayIdx;
+        wayIdx += 4;
+    }
+    return count < 64 ? hits & ((1ULL << count) - 1) : hits;
+}
+
+// Eight ways per step
+__attribute__((target("avx2")))
+static WayMask matchTagsAvx2(const unsigned int *tags, const unsigned char *states,
+                             unsigned int tag, unsigned char invalidState, int count)
+{
+    __m256i probe = _mm256_set1_epi32(tag);
+    __m128i invalid = _mm_set1_epi8(invalidState);
+    WayMask hits = 0;
+    int wayIdx = 0;
+    while (wayIdx < count)
+    {
+        __m256i tagLanes = _mm256_loadu_si256((const __m256i *)(tags + wayIdx));
+        unsigned int tagBits = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(tagLanes, probe)));
+        __m128i stateLanes = _mm_loadl_epi64((const __m128i *)(states + wayIdx));
+        unsigned int invalidBits = _mm_movemask_epi8(_mm_cmpeq_epi8(stateLanes, invalid)) & 0xFF;
+        hits |= (WayMask)(tagBits & ~invalidBits) << wayIdx;
+        wayIdx += 8;
+    }
+    return count < 64 ? hits & ((1ULL << count) - 1) : hits;
+}
+
+// Two (SSE) or four (AVX2) 64-bit tags per step
+__attribute__((target("sse4.1")))
+static WayMask matchWideTagsSse4(const unsigned long long *tags, const unsigned char *states,
+                                 unsigned long long tag, unsigned char invalidState, int count)
+{
+    __m128i probe = _mm_set1_epi64x((long long)tag);
+    __m128i invalid = _mm_set1_epi8(invalidState);
+    WayMask hits = 0;
+    int wayIdx = 0;
+    while (wayIdx < count)
+    {
+        __m128i tagLanes = _mm_loadu_si128((const __m128i *)(tags + wayIdx));
+        unsigned int tagBits = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(tagLanes, probe)));
+        unsigned short stateWord;
+        memcpy(&stateWord, states + wayIdx, sizeof(stateWord));
+        unsigned int invalidBits = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_cvtsi32_si128(stateWord), invalid)) & 0x3;
+        hits |= (WayMask)(tagBits & ~invalidBits) << wayIdx;
+        wayIdx += 2;
+    }
+    return count < 64 ? hits & ((1ULL << count) - 1) : hits;
+}
+
+__attribute__((target("avx2")))
+static WayMask matchWideTagsAvx2(const unsigned long long *tags, const unsigned char *states,
+                                 unsigned long long tag, unsigned char invalidState, int count)
+{
+    __m256i probe = _mm256_set1_epi64x((long long)tag);
+    __m128i invalid = _mm_set1_epi8(invalidState);
+    WayMask hits = 0;
+    int wayIdx = 0;
+    while (wayIdx < count)
+    {
+        __m256i tagLanes = _mm256_loadu_si256((const __m256i *)(tags + wayIdx));
+        unsigned int tagBits = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(tagLanes, probe)));
+        int stateWord;
+        memcpy(&stateWord, states + wayIdx, sizeof(stateWord));
+        unsigned int invalidBits = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_cvtsi32_si128(stateWord), invalid)) & 0xF;
+        hits |= (WayMask)(tagBits & ~invalidBits) << wayIdx;
+        wayIdx += 4;
+    }
+    return count < 64 ? hits & ((1ULL << count) - 1) : hits;
+}
+
+// Sixteen (SSE) or thirty-two (AVX2) state bytes per step
+__attribute__((target("sse4.1")))
+static WayMask matchStatesSse4(const unsigned char *states, unsigned char state, int count)
+{
+    __m128i probe = _mm_set1_epi8(state);
+    WayMask hits = 0;
+    int wayIdx = 0;
+    while (wayIdx < count)
+    {
+        __m128i lanes = _mm_loadu_si128((const __m128i *)(states + wayIdx));
+        hits |= (WayMask)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(lanes, probe)) << wayIdx;
+        wayIdx += 16;
+    }
+    return count < 64 ? hits & ((1ULL << count) - 1) : hits;
+}
+
+__attribute__((target("avx2")))
+static WayMask matchStatesAvx2(const unsigned char *states, unsigned char state, int count)
+{
+    __m256i probe = _mm256_set1_epi8(state);
+    WayMask hits = 0;
+    int wayIdx = 0;
+    while (wayIdx < count)
+    {
+        __m256i lanes = _mm256_loadu_si256((const __m256i *)(states + wayIdx));
+        hits |= (WayMask)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lanes, probe)) << wayIdx;
+        wayIdx += 32;
+    }
+    return count < 64 ? hits & ((1ULL << count) - 1) : hits;
+}
+#endif // HAVE_X86_SIMD
+
+TagMatchFunction matchTags = matchTagsScalar;
+WideTagMatchFunction matchWideTags = matchWideTagsScalar;
+StateMatchFunction matchStates = matchStatesScalar;
+
+// The library switches to the widest implementation while the program
+// loads, before any Simulator can run; code that runs earlier still
+// matches correctly, on the scalar path
+static const bool widestSelected = selectTagMatch("auto");
+
+bool selectTagMatch(const string &request)
+{
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    bool haveAvx2 = __builtin_cpu_supports("avx2");
+    bool haveSse4 = __builtin_cpu_supports("sse4.1");
+
+    if (request == "avx2" || (request == "auto" && haveAvx2))
+    {
+        if (!haveAvx2)
+        {
+            return false;
+        }
+        matchTags = matchTagsAvx2;
+        matchWideTags = matchWideTagsAvx2;
+        matchStates = matchStatesAvx2;
+        return true;
+    }
+    if (request == "sse4" || (request == "auto" && haveSse4))
+    {
+        if (!haveSse4)
+        {
+            return false;
+        }
+        matchTags = matchTagsSse4;
+        matchWideTags = matchWideTagsSse4;
+        matchStates = matchStatesSse4;
+        return true;
+    }
+#endif
+    if (request == "scalar" || request == "auto")
+    {
+        matchTags = matchTagsScalar;
+        matchWideTags = matchWideTagsScalar;
+        matchStates = matchStatesScalar;
+        return true;
+    }
+    return false;
+}
+
+const char *activeTagMatchName()
+{
+#ifdef HAVE_X86_SIMD
+    if (matchTags == matchTagsAvx2)
+    {
+        return "avx2";
+    }
+    if (matchTags == matchTagsSse4)
+    {
+        return "sse4";
+    }
+#endif
+    return "scalar";
+}
@@ -0,0 +1,37 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <string>
+
+// Bit i set = way (firstWay + i) of a set holds the probe tag in a valid state
+typedef unsigned long long WayMask;
+
+// Compare tag against count (<= 64) consecutive ways. States are one byte
+// per way; invalidState marks an empty line. Implementations may read up to
+// 32 bytes past the last tag or state, which CacheUnit storage pads for.
+typedef WayMask (*TagMatchFunction)(const unsigned int *tags, const unsigned char *states,
+                                    unsigned int tag, unsigned char invalidState, int count);
+
+// The same for caches whose tags need more than 32 bits
+typedef WayMask (*WideTagMatchFunction)(const unsigned long long *tags, const unsigned char *states,
+                                        unsigned long long tag, unsigned char invalidState, int count);
+
+// Ways among count (<= 64) consecutive one-byte states equal to state
+typedef WayMask (*StateMatchFunction)(const unsigned char *states, unsigned char state, int count);
+
+// Implementations in use: the widest the host supports, chosen once when the
+// program loads, unless selectTagMatch() overrides them
+extern TagMatchFunction matchTags;
+extern WideTagMatchFunction matchWideTags;
+extern StateMatchFunction matchStates;
+
+// Test and benchmark override (--simd): pick the widest implementation the
+// host supports ("auto"), or force "avx2", "sse4" or "scalar". Returns false
+// if the request is unsupported. The choice is shared by every simulation,
+// so call it only while no Simulator is running.
+bool selectTagMatch(const std::string &request);
+
+// Name of the implementation matchTags currently points to
+const char *activeTagMatchName();
+
+#endif // SIMD_HPP
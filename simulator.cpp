@@ -0,0 +1,982 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include "main.hpp"
+#include "bus.hpp"
+#include "cache.hpp"
+#include "llc.hpp"
+#include "trace.hpp"
+#include "parallel.hpp"
+#include "sampling.hpp"
+#include "state.hpp"
+#include "simulator.hpp"
+#include "checkpoint.hpp"
+#include "profile.hpp"
+
+using namespace std;
+
+thread_local SimulationState *sim = nullptr;
+
+void resetCounters()
+{
+    sim->busTransactionCount = 0;
+    sim->totalBusTraffic = 0;
+    sim->busBusyCycles = 0;
+    sim->snoopsAvoided = 0;
+    sim->runAheadConflicts = 0;
+    sim->quantumSlipCycles = 0;
+    sim->llcHits = 0;
+    sim->llcMisses = 0;
+    sim->llcBackInvalidations = 0;
+    sim->memoryWritebacks = 0;
+    sim->operationCounter = 0;
+    sim->executedInstructions.assign(sim->numCores, 0);
+    sim->totalCycles.assign(sim->numCores, 0);
+    sim->readCount.assign(sim->numCores, 0);
+    sim->writeCount.assign(sim->numCores, 0);
+    sim->missCount.assign(sim->numCores, 0);
+    sim->evictionCount.assign(sim->numCores, 0);
+    sim->writebackCount.assign(sim->numCores, 0);
+    sim->invalidationCount.assign(sim->numCores, 0);
+    sim->trafficBytes.assign(sim->numCores, 0);
+    sim->stalledCycles.assign(sim->numCores, 0);
+}
+
+void initializeCaches(int tagBytes)
+{
+    sim->tagBytes = tagBytes;
+    int initIdx = 0;
+    while (initIdx < sim->numCores)
+    {
+        sim->processorCaches[initIdx].initialize(sim->numSetBits, sim->numBlockBits, sim->associativity, tagBytes,
+                                                 initIdx + 1);
+        initializeReplacement(sim->processorCaches[initIdx], sim->replacementPolicy);
+        initIdx++;
+    }
+}
+
+void initializeSimulation()
+{
+    // Initialize caches and coherence state
+    initializeCaches(4);
+    if (sim->snoopFilterEnabled)
+    {
+        sim->sharerDirectory.reset((size_t)sim->numCores * sim->processorCaches[0].totalSets * sim->associativity,
+                                   sim->numSetBits);
+    }
+    initializeLlc();
+    initializeBus();
+
+    // Initialize counters
+    resetCounters();
+    sim->warmedAccesses.assign(sim->numCores, 0);
+    sim->sampledAccesses.assign(sim->numCores, 0);
+    sim->samples.clear();
+
+    // Nothing has run yet
+    sim->processorRunning.assign(sim->numCores, true);
+    sim->traceCursor.clear();
+    sim->currentOp.clear();
+    sim->quantumCores.clear();
+    sim->quantumWorkers.reset();
+    sim->engineStarted = false;
+    sim->simulationActive = true;
+    sim->currentCycle = 0;
+    sim->peakCycles = 0;
+    sim->hostProfile = HostProfile();
+}
+
+// Number of upcoming cycles in which no core can retire and the bus only
+// counts down its current transfer. Each running core is waiting on its own
+// bus operation or on a queued request, so every such cycle has the same
+// effect and they can be applied in one step.
+static int computeIdleCycles()
+{
+    int procId = 0;
+    while (procId < sim->numCores)
+    {
+        if (sim->processorRunning[procId] && !isWaitingOnBus(procId))
+        {
+            return 0;
+        }
+        procId++;
+    }
+    return cyclesUntilBusEvent();
+}
+
+void limitCoreRegion(int coreId, TraceCursor &cursor, unsigned long long regionPosition)
+{
+    if (sim->regionAccesses > 0)
+    {
+        limitTraceCursor(cursor, sim->regionAccesses - regionPosition, sim->regionLimits[coreId]);
+    }
+}
+
+void warmCaches(long long rounds, vector<long long> &applied)
+{
+    vector<TraceCursor> &traceCursor = sim->traceCursor;
+    bool warming = true;
+    long long round = 0;
+    while (warming && round < rounds)
+    {
+        warming = false;
+        int procId = 0;
+        while (procId < sim->numCores)
+        {
+            if (traceCursor[procId].hasEntry())
+            {
+                executeMemoryOperation(decodeTraceEntry(traceCursor[procId].current()), procId);
+                settleBusTransactions();
+                traceCursor[procId].advance();
+                applied[procId]++;
+                warming = true;
+            }
+            procId++;
+        }
+        round++;
+    }
+    sim->snoopedCoreMask = 0;
+}
+
+// Fast-forward (--ffwd) over each core's first accesses. Only the caches,
+// sharer directory and trace positions carry over; counters restart from
+// zero for the detailed region.
+static void fastForwardCores()
+{
+    warmCaches(sim->fastForwardAccesses, sim->warmedAccesses);
+    resetCounters();
+}
+
+// Open every core's trace, fast-forward it to its detailed region and
+// decode its first entry there. The still empty caches get wide tags if an
+// address leaves more than 32 tag bits.
+static void openCoreTraces()
+{
+    sim->traceCursor.resize(sim->numCores);
+    sim->currentOp.resize(sim->numCores);
+    int addressBits = 0;
+    int openIdx = 0;
+    while (openIdx < sim->numCores)
+    {
+        sim->traceCursor[openIdx] = openTraceCursor(sim->coreTraces[openIdx], sim->coreSources[openIdx]);
+        addressBits = max(addressBits, traceAddressBits(sim->coreTraces[openIdx], sim->coreSources[openIdx]));
+        openIdx++;
+    }
+    if (addressBits - sim->numSetBits - sim->numBlockBits > 32)
+    {
+        initializeCaches(8);
+    }
+    if (sim->fastForwardAccesses > 0)
+    {
+        fastForwardCores();
+    }
+
+    int decodeIdx = 0;
+    while (decodeIdx < sim->numCores)
+    {
+        limitCoreRegion(decodeIdx, sim->traceCursor[decodeIdx], 0);
+        if (sim->traceCursor[decodeIdx].hasEntry())
+        {
+            sim->currentOp[decodeIdx] = decodeTraceEntry(sim->traceCursor[decodeIdx].current());
+        }
+        decodeIdx++;
+    }
+}
+
+// Functional mode: cores take turns, one access each, and every access is
+// settled on the bus before the next, so only event counts are produced.
+// The clock counts rounds.
+static bool advanceFunctionalSimulation(long long targetRound)
+{
+    vector<TraceCursor> &traceCursor = sim->traceCursor;
+    while (sim->simulationActive && sim->currentCycle < targetRound)
+    {
+        sim->simulationActive = false;
+        int procId = 0;
+        while (procId < sim->numCores)
+        {
+            if (!traceCursor[procId].hasEntry())
+            {
+                sim->processorRunning[procId] = false;
+                procId++;
+                continue;
+            }
+            sim->simulationActive = true;
+
+            TraceRecord currentOp = decodeTraceEntry(traceCursor[procId].current());
+            executeMemoryOperation(currentOp, procId);
+            settleBusTransactions();
+
+            sim->executedInstructions[procId]++;
+            if (currentOp.isWrite)
+            {
+                sim->writeCount[procId]++;
+            }
+            else
+            {
+                sim->readCount[procId]++;
+            }
+            traceCursor[procId].advance();
+            procId++;
+        }
+        sim->currentCycle++;
+    }
+    return sim->simulationActive;
+}
+
+bool advanceSerialSimulation(long long targetCycle)
+{
+    vector<TraceCursor> &traceCursor = sim->traceCursor;
+    vector<TraceRecord> &currentOp = sim->currentOp;
+
+    while (sim->simulationActive && sim->currentCycle < targetCycle)
+    {
+        // Event-driven mode: jump straight to the next cycle where state changes
+        if (sim->eventDrivenClock)
+        {
+            int idleCycles = computeIdleCycles();
+            if (idleCycles > 0)
+            {
+                int skipIdx = 0;
+                while (skipIdx < sim->numCores)
+                {
+                    if (sim->processorRunning[skipIdx])
+                    {
+                        skipWaitingCycles(skipIdx, idleCycles);
+                    }
+                    skipIdx++;
+                }
+                skipBusCycles(idleCycles);
+                sim->currentCycle += idleCycles;
+                sim->peakCycles = max(sim->peakCycles, sim->currentCycle);
+            }
+        }
+
+        // Process each processor in round-robin order
+        int procId = 0;
+        while (procId < sim->numCores)
+        {
+            // Skip completed processors
+            if (!sim->processorRunning[procId])
+            {
+                procId++;
+                continue;
+            }
+
+            // Check if processor has remaining instructions
+            if (traceCursor[procId].hasEntry())
+            {
+                executeMemoryOperation(currentOp[procId], procId);
+            }
+            else
+            {
+                sim->processorRunning[procId] = false;
+            }
+            procId++;
+        }
+
+        processBusTransactions();
+
+        // Advance trace position for non-stalled processors
+        int updateIdx = 0;
+        while (updateIdx < sim->numCores)
+        {
+            if (!sim->processorCaches[updateIdx].isStalled && sim->processorRunning[updateIdx])
+            {
+                sim->executedInstructions[updateIdx]++;
+
+                // Count reads and writes as they retire
+                if (currentOp[updateIdx].isWrite)
+                {
+                    sim->writeCount[updateIdx]++;
+                }
+                else
+                {
+                    sim->readCount[updateIdx]++;
+                }
+
+                if (!traceCursor[updateIdx].advance())
+                {
+                    sim->processorRunning[updateIdx] = false;
+                }
+                else
+                {
+                    currentOp[updateIdx] = decodeTraceEntry(traceCursor[updateIdx].current());
+                }
+            }
+            updateIdx++;
+        }
+
+        // Check if simulation should continue
+        sim->simulationActive = false;
+        int checkIdx = 0;
+        while (checkIdx < sim->numCores)
+        {
+            if (sim->processorRunning[checkIdx] || sim->processorCaches[checkIdx].isStalled || !sim->dataTransferQueue.empty())
+            {
+                sim->simulationActive = true;
+                break;
+            }
+            checkIdx++;
+        }
+
+        sim->currentCycle++;
+        sim->peakCycles = max(sim->peakCycles, sim->currentCycle);
+    }
+    return sim->simulationActive;
+}
+
+bool advanceSimulation(long long targetCycle)
+{
+    if (!sim->engineStarted)
+    {
+        sim->engineStarted = true;
+        openCoreTraces();
+        if (sim->parallelThreads > 0 && !sim->functionalMode)
+        {
+            beginQuantumSimulation();
+        }
+    }
+
+    if (sim->functionalMode)
+    {
+        return advanceFunctionalSimulation(targetCycle);
+    }
+    if (sim->samplePeriod > 0)
+    {
+        return advanceSampledSimulation(targetCycle);
+    }
+    if (sim->parallelThreads > 0)
+    {
+        return advanceQuantumSimulation(targetCycle);
+    }
+    return advanceSerialSimulation(targetCycle);
+}
+
+SimulationTiming simulationTiming()
+{
+    if (sim->functionalMode)
+    {
+        return SimulationTiming{0, 0};
+    }
+    if (sim->samplePeriod > 0)
+    {
+        // Estimated; the clock only covers the last unit
+        SamplingEstimates estimates = samplingEstimates();
+        double peakCycles = 0.0;
+        for (const SampleEstimate &core : estimates.coreCycles)
+        {
+            peakCycles = max(peakCycles, core.value);
+        }
+        return SimulationTiming{llround(estimates.simulationCycles.value), llround(peakCycles)};
+    }
+    return SimulationTiming{sim->currentCycle - 1, sim->peakCycles};
+}
+
+// "value ± half-width unit" padded to the report's 37-column value field
+static string estimateLabel(const SampleEstimate &estimate, int precision, const string &unit)
+{
+    ostringstream text;
+    text << fixed << setprecision(precision) << estimate.value << unit;
+    if (estimate.halfWidth >= 0.0)
+    {
+        text << " ± " << estimate.halfWidth << unit;
+    }
+    else
+    {
+        text << " (no interval)";
+    }
+    string label = text.str();
+    // The ± sign is two bytes wide in UTF-8 but one column on screen
+    label.resize(estimate.halfWidth >= 0.0 ? 38 : 37, ' ');
+    return label;
+}
+
+// Sampled runs report their estimates instead of the last unit's counters
+static void printSamplingEstimates(ostream &output)
+{
+    SamplingEstimates estimates = samplingEstimates();
+    output << "┌──────────────────────────────────────────────────────────────────┐\n";
+    output << "│                SAMPLING ESTIMATES (95% CONFIDENCE)               │\n";
+    output << "├──────────────────────────────────────────────────────────────────┤\n";
+    output << "│  Measured Units:            " << setw(14) << estimates.units << "                       │\n";
+    output << "│  Measured Accesses:         " << setw(14) << estimates.measuredAccesses << "                       │\n";
+    output << "│  Total Accesses:            " << setw(14) << estimates.totalAccesses << "                       │\n";
+    output << "├──────────────────────────────────────────────────────────────────┤\n";
+    output << "│  Simulation Cycles:         " << estimateLabel(estimates.simulationCycles, 0, "") << "│\n";
+    output << "│  Miss Rate:                 " << estimateLabel(estimates.missRate, 3, "%") << "│\n";
+    output << "│  Bus Traffic:               " << estimateLabel(estimates.busTraffic, 0, " B") << "│\n";
+    int coreIdx = 0;
+    while (coreIdx < sim->numCores)
+    {
+        string label = "Core " + to_string(coreIdx) + " Exec Cycles:";
+        label.resize(27, ' ');
+        output << "│  " << label << estimateLabel(estimates.coreCycles[coreIdx], 0, "") << "│\n";
+        coreIdx++;
+    }
+    output << "└──────────────────────────────────────────────────────────────────┘\n";
+}
+
+// Shared LLC section of the report
+static void printLlcSummary(ostream &output)
+{
+    double llcKB = ((1LL << sim->llcSetBits) * sim->llcWays * (1LL << sim->llcBlockBits)) / 1024.0;
+    long long lookups = sim->llcHits + sim->llcMisses;
+    double llcHitRate = lookups > 0 ? (sim->llcHits * 100.0) / lookups : 0.0;
+    string geometryLabel = "s=" + to_string(sim->llcSetBits) + " E=" + to_string(sim->llcWays) +
+                           " b=" + to_string(sim->llcBlockBits);
+    string inclusionLabel = llcInclusionName(sim->llcInclusion);
+    string policyLabel = replacementPolicyName(sim->llcPolicy);
+    geometryLabel.resize(37, ' ');
+    inclusionLabel.resize(37, ' ');
+    policyLabel.resize(37, ' ');
+
+    output << "\n┌──────────────────────────────────────────────────────────────────┐\n";
+    output << "│                     SHARED LLC                                   │\n";
+    output << "├──────────────────────────────────────────────────────────────────┤\n";
+    output << "│  Geometry:                  " << geometryLabel << "│\n";
+    output << fixed << setprecision(2);
+    output << "│  LLC Size:                  " << setw(8) << llcKB << " KB                          │\n";
+    output << "│  Inclusion Policy:          " << inclusionLabel << "│\n";
+    output << "│  Replacement Policy:        " << policyLabel << "│\n";
+    output << "│  Hit Latency (cycles):              " << setw(14) << sim->llcHitCycles << "            │\n";
+    output << "│  LLC Hits:                          " << setw(14) << sim->llcHits << "            │\n";
+    output << "│  LLC Misses:                        " << setw(14) << sim->llcMisses << "            │\n";
+    output << fixed << setprecision(5);
+    output << "│  LLC Hit Rate:                      " << setw(13) << llcHitRate << "%            │\n";
+    output << "│  Back-invalidations:                " << setw(14) << sim->llcBackInvalidations << "            │\n";
+    output << "│  Memory Writebacks:                 " << setw(14) << sim->memoryWritebacks << "            │\n";
+    output << "└──────────────────────────────────────────────────────────────────┘\n";
+}
+
+// Boxed report of the bound simulation
+static void printSimulationReport(ostream &output, const SimulationTiming &timing)
+{
+    // Calculate totals
+    int blockBytes = 1 << sim->numBlockBits;
+    int setCount = 1 << sim->numSetBits;
+    double cacheSizeKB = (setCount * sim->associativity * blockBytes) / 1024.0;
+    
+    long long totalInstructions = 0;
+    long long totalReads = 0;
+    long long totalWrites = 0;
+    long long totalMisses = 0;
+    long long totalEvictions = 0;
+    long long totalWritebacks = 0;
+    long long totalInvalidations = 0;
+    long long totalDataTraffic = 0;
+    
+    int calcIdx = 0;
+    while (calcIdx < sim->numCores)
+    {
+        totalInstructions += sim->executedInstructions[calcIdx];
+        totalReads += sim->readCount[calcIdx];
+        totalWrites += sim->writeCount[calcIdx];
+        totalMisses += sim->missCount[calcIdx];
+        totalEvictions += sim->evictionCount[calcIdx];
+        totalWritebacks += sim->writebackCount[calcIdx];
+        totalInvalidations += sim->invalidationCount[calcIdx];
+        totalDataTraffic += sim->trafficBytes[calcIdx];
+        calcIdx++;
+    }
+
+    // Print simulation results
+    output << "\n╔══════════════════════════════════════════════════════════════════╗\n";
+    output << "║           MULTICORE CACHE SIMULATOR - SIMULATION REPORT          ║\n";
+    output << "╚══════════════════════════════════════════════════════════════════╝\n\n";
+
+    output << "┌──────────────────────────────────────────────────────────────────┐\n";
+    output << "│                     SIMULATION PARAMETERS                        │\n";
+    output << "├──────────────────────────────────────────────────────────────────┤\n";
+    output << "│  Set Index Bits (s):        " << setw(8) << sim->numSetBits << "                            │\n";
+    output << "│  Associativity (E):         " << setw(8) << sim->associativity << "                            │\n";
+    output << "│  Block Bits (b):            " << setw(8) << sim->numBlockBits << "                            │\n";
+    output << "│  Block Size:                " << setw(5) << blockBytes << " bytes                        │\n";
+    output << "│  Number of Sets:            " << setw(8) << setCount << "                            │\n";
+    output << fixed << setprecision(2);
+    output << "│  Cache Size (per core):     " << setw(5) << cacheSizeKB << " KB                          │\n";
+    output << "│  Total Cache Size:          " << setw(5) << cacheSizeKB * sim->numCores << " KB                          │\n";
+    output << "├──────────────────────────────────────────────────────────────────┤\n";
+    output << "│  Coherence Protocol:        MESI (Illinois)                      │\n";
+    output << "│  Write Policy:              Write-back, Write-allocate           │\n";
+    string policyLabel = replacementPolicyName(sim->replacementPolicy);
+    policyLabel.resize(37, ' ');
+    output << "│  Replacement Policy:        " << policyLabel << "│\n";
+    output << "│  Bus Architecture:          Central Snooping Bus                 │\n";
+    string coreLabel = to_string(sim->numCores);
+    coreLabel.resize(37, ' ');
+    output << "│  Number of Cores:           " << coreLabel << "│\n";
+    if (sim->fastForwardAccesses > 0 || sim->regionAccesses > 0)
+    {
+        string warmLabel = to_string(sim->fastForwardAccesses) + " per core";
+        string regionLabel = sim->regionAccesses > 0 ? to_string(sim->regionAccesses) + " per core" : "rest of trace";
+        warmLabel.resize(37, ' ');
+        regionLabel.resize(37, ' ');
+        output << "│  Fast-forward Accesses:     " << warmLabel << "│\n";
+        output << "│  Detailed Accesses:         " << regionLabel << "│\n";
+    }
+    if (sim->samplePeriod > 0)
+    {
+        string samplingLabel = to_string(sim->sampleWarmup) + " + " + to_string(sim->sampleWindow) + " of every " +
+                               to_string(sim->samplePeriod);
+        samplingLabel.resize(37, ' ');
+        output << "│  Sampled (per core):        " << samplingLabel << "│\n";
+    }
+    output << "└──────────────────────────────────────────────────────────────────┘\n\n";
+
+    if (sim->samplePeriod > 0)
+    {
+        printSamplingEstimates(output);
+        return;
+    }
+
+    output << "┌──────────────────────────────────────────────────────────────────┐\n";
+    output << "│                     PER-CORE STATISTICS                          │\n";
+    output << "└──────────────────────────────────────────────────────────────────┘\n\n";
+
+    int statIdx = 0;
+    while (statIdx < sim->numCores)
+    {
+        double missPercent = (sim->readCount[statIdx] + sim->writeCount[statIdx] > 0) 
+            ? (sim->missCount[statIdx] * 100.0) / (sim->readCount[statIdx] + sim->writeCount[statIdx]) : 0.0;
+        double hitPercent = 100.0 - missPercent;
+        double readPercent = (sim->readCount[statIdx] + sim->writeCount[statIdx] > 0)
+            ? (sim->readCount[statIdx] * 100.0) / (sim->readCount[statIdx] + sim->writeCount[statIdx]) : 0.0;
+        double writePercent = 100.0 - readPercent;
+        long long cacheHits = sim->readCount[statIdx] + sim->writeCount[statIdx] - sim->missCount[statIdx];
+        double ipc = (sim->totalCycles[statIdx] + sim->executedInstructions[statIdx] > 0)
+            ? (double)sim->executedInstructions[statIdx] / (sim->totalCycles[statIdx] + sim->executedInstructions[statIdx]) : 0.0;
+
+        output << "┌─────────────────────── CORE " << statIdx << " ───────────────────────────────────┐\n";
+        output << "│  Memory Access Summary:                                          │\n";
+        output << "│    Total Instructions:      " << setw(12) << sim->executedInstructions[statIdx] << "                      │\n";
+        output << "│    Total Reads:             " << setw(12) << sim->readCount[statIdx] << " (" << setw(5) << fixed << setprecision(2) << readPercent << "%)               │\n";
+        output << "│    Total Writes:            " << setw(12) << sim->writeCount[statIdx] << " (" << setw(5) << writePercent << "%)               │\n";
+        output << "│                                                                  │\n";
+        output << "│  Cache Performance:                                              │\n";
+        output << "│    Cache Hits:              " << setw(12) << cacheHits << "                      │\n";
+        output << "│    Cache Misses:            " << setw(12) << sim->missCount[statIdx] << "                      │\n";
+        output << fixed << setprecision(5);
+        output << "│    Hit Rate:                " << setw(11) << hitPercent << "%                      │\n";
+        output << "│    Miss Rate:               " << setw(11) << missPercent << "%                      │\n";
+        output << "│                                                                  │\n";
+        output << "│  Cache Events:                                                   │\n";
+        output << "│    Evictions:               " << setw(12) << sim->evictionCount[statIdx] << "                      │\n";
+        output << "│    Writebacks:              " << setw(12) << sim->writebackCount[statIdx] << "                      │\n";
+        output << "│    Bus Invalidations:       " << setw(12) << sim->invalidationCount[statIdx] << "                      │\n";
+        output << "│                                                                  │\n";
+        if (sim->functionalMode)
+        {
+            output << "│  Traffic:                                                        │\n";
+        }
+        else
+        {
+            output << "│  Timing & Traffic:                                               │\n";
+            output << "│    Execution Cycles:        " << setw(12) << sim->totalCycles[statIdx] + sim->executedInstructions[statIdx] << "                      │\n";
+            output << "│    Idle/Stall Cycles:       " << setw(12) << sim->stalledCycles[statIdx] << "                      │\n";
+            output << fixed << setprecision(4);
+            output << "│    IPC (approx):            " << setw(12) << ipc << "                      │\n";
+        }
+        output << "│    Data Traffic:            " << setw(9) << sim->trafficBytes[statIdx] << " bytes                 │\n";
+        output << "└──────────────────────────────────────────────────────────────────┘\n\n";
+        statIdx++;
+    }
+
+    double overallMissRate = (totalReads + totalWrites > 0) 
+        ? (totalMisses * 100.0) / (totalReads + totalWrites) : 0.0;
+    double overallHitRate = 100.0 - overallMissRate;
+
+    output << "┌──────────────────────────────────────────────────────────────────┐\n";
+    output << "│                     AGGREGATE STATISTICS                         │\n";
+    output << "├──────────────────────────────────────────────────────────────────┤\n";
+    output << "│  Total Instructions (all cores):    " << setw(14) << totalInstructions << "            │\n";
+    output << "│  Total Memory Accesses:             " << setw(14) << totalReads + totalWrites << "            │\n";
+    output << "│  Total Reads:                       " << setw(14) << totalReads << "            │\n";
+    output << "│  Total Writes:                      " << setw(14) << totalWrites << "            │\n";
+    output << "│  Total Cache Hits:                  " << setw(14) << (totalReads + totalWrites - totalMisses) << "            │\n";
+    output << "│  Total Cache Misses:                " << setw(14) << totalMisses << "            │\n";
+    output << fixed << setprecision(5);
+    output << "│  Overall Hit Rate:                  " << setw(13) << overallHitRate << "%            │\n";
+    output << "│  Overall Miss Rate:                 " << setw(13) << overallMissRate << "%            │\n";
+    output << "│  Total Evictions:                   " << setw(14) << totalEvictions << "            │\n";
+    output << "│  Total Writebacks:                  " << setw(14) << totalWritebacks << "            │\n";
+    output << "│  Total Invalidations:               " << setw(14) << totalInvalidations << "            │\n";
+    output << "└──────────────────────────────────────────────────────────────────┘\n\n";
+
+    output << "┌──────────────────────────────────────────────────────────────────┐\n";
+    output << "│                     BUS & COHERENCE SUMMARY                      │\n";
+    output << "├──────────────────────────────────────────────────────────────────┤\n";
+    output << "│  Total Bus Transactions:            " << setw(14) << sim->busTransactionCount << "            │\n";
+    output << "│  Total Bus Traffic:                 " << setw(11) << sim->totalBusTraffic << " bytes         │\n";
+    output << "│  Total Core Data Traffic:           " << setw(11) << totalDataTraffic << " bytes         │\n";
+    double avgBusTransPerInstr = (totalInstructions > 0) 
+        ? (double)sim->busTransactionCount / totalInstructions : 0.0;
+    output << fixed << setprecision(6);
+    output << "│  Bus Transactions per Instruction:  " << setw(14) << avgBusTransPerInstr << "            │\n";
+    if (sim->snoopFilterEnabled)
+    {
+        output << "│  Snoops Avoided by Filter:          " << setw(14) << sim->snoopsAvoided << "            │\n";
+    }
+    output << "└──────────────────────────────────────────────────────────────────┘\n";
+
+    if (sim->llcWays > 0)
+    {
+        printLlcSummary(output);
+    }
+
+    // Functional runs are untimed
+    if (sim->functionalMode)
+    {
+        return;
+    }
+
+    output << "\n┌──────────────────────────────────────────────────────────────────┐\n";
+    output << "│                     TIMING SUMMARY                               │\n";
+    output << "├──────────────────────────────────────────────────────────────────┤\n";
+    output << "│  Total Simulation Cycles:           " << setw(14) << timing.simulationCycles << "            │\n";
+    output << "│  Maximum Execution Time:            " << setw(14) << timing.peakCycles << "            │\n";
+    if (sim->parallelThreads > 0)
+    {
+        output << "│  Parallel Host Threads:             " << setw(14) << min(sim->parallelThreads, sim->numCores) << "            │\n";
+        output << "│  Quantum (cycles):                  " << setw(14) << sim->quantumCycles << "            │\n";
+        output << "│  Run-ahead Conflicts:               " << setw(14) << sim->runAheadConflicts << "            │\n";
+        output << "│  Quantum Slip Cycles:               " << setw(14) << sim->quantumSlipCycles << "            │\n";
+    }
+    output << "└──────────────────────────────────────────────────────────────────┘\n";
+}
+
+Simulator::Simulator() : state(new SimulationState()), tracesAttached(false)
+{
+    configure(SimulatorConfig());
+}
+
+Simulator::~Simulator()
+{
+}
+
+const char *Simulator::configure(const SimulatorConfig &config)
+{
+    if (config.cores < 1 || config.cores > MAX_CORES)
+    {
+        return "Core count (-n) must be between 1 and 64.";
+    }
+    if (config.setBits < 0 || config.blockBits < 1 || config.setBits + config.blockBits > 30)
+    {
+        return "Set and block bits must satisfy s >= 0, b >= 1, s + b <= 30.";
+    }
+    const char *geometry = geometryError(config.ways, config.policy);
+    if (geometry != nullptr)
+    {
+        return geometry;
+    }
+    if (config.parallelThreads < 0 || config.quantumCycles < 1)
+    {
+        return "The parallel engine needs a thread count >= 0 and a quantum >= 1 cycle.";
+    }
+    if (config.functional && config.parallelThreads > 0)
+    {
+        return "Functional mode is untimed and cannot use the parallel engine.";
+    }
+    if (config.fastForward < 0 || config.region < 0)
+    {
+        return "Fast-forward and region access counts cannot be negative.";
+    }
+    if (config.samplePeriod < 0 || (config.samplePeriod > 0 && (config.sampleWindow < 1 || config.sampleWarmup < 0 ||
+                                                                config.sampleWarmup + config.sampleWindow > config.samplePeriod)))
+    {
+        return "Sampling needs a window of at least 1 access and warm-up + window <= period.";
+    }
+    if (config.samplePeriod > 0 && (config.functional || config.parallelThreads > 0))
+    {
+        return "Sampling measures on the serial timed engine, not in functional mode or the parallel engine.";
+    }
+    if (config.llcWays > 0)
+    {
+        if (config.llcWays > 255)
+        {
+            return "LLC associativity must be between 1 and 255.";
+        }
+        const char *llcGeometry = geometryError(config.llcWays, config.llcPolicy);
+        if (llcGeometry != nullptr)
+        {
+            return llcGeometry;
+        }
+        if (config.llcSetBits < 0 || config.llcBlockBits < config.blockBits || config.llcSetBits + config.llcBlockBits > 30)
+        {
+            return "LLC set and block bits must satisfy s >= 0, b >= the L1's b, s + b <= 30.";
+        }
+        if (config.llcInclusion == LlcInclusion::EXCLUSIVE && config.llcBlockBits != config.blockBits)
+        {
+            return "An exclusive LLC swaps whole blocks with the L1s and needs their block size.";
+        }
+        if (config.llcHitCycles < 1)
+        {
+            return "The LLC hit latency must be at least 1 cycle.";
+        }
+    }
+
+    settings = config;
+    state->numCores = config.cores;
+    state->numSetBits = config.setBits;
+    state->associativity = config.ways;
+    state->numBlockBits = config.blockBits;
+    state->replacementPolicy = config.policy;
+    state->eventDrivenClock = config.eventDriven;
+    state->functionalMode = config.functional;
+    state->snoopFilterEnabled = config.snoopFilter;
+    state->parallelThreads = config.parallelThreads;
+    state->quantumCycles = config.quantumCycles;
+    state->fastForwardAccesses = config.fastForward;
+    state->regionAccesses = config.region;
+    state->samplePeriod = config.samplePeriod;
+    state->sampleWindow = config.sampleWindow;
+    state->sampleWarmup = config.sampleWarmup;
+    state->llcWays = config.llcWays;
+    state->llcSetBits = config.llcSetBits;
+    state->llcBlockBits = config.llcBlockBits;
+    state->llcPolicy = config.llcPolicy;
+    state->llcInclusion = config.llcInclusion;
+    state->llcHitCycles = config.llcHitCycles;
+
+    // Start over from empty fed traces
+    int coreIdx = 0;
+    while (coreIdx < MAX_CORES)
+    {
+        fedTraces[coreIdx].clear();
+        state->coreTraces[coreIdx] = TraceView{nullptr, 0};
+        state->coreSources[coreIdx] = nullptr;
+        state->regionLimits[coreIdx].reset();
+        state->sampleLimits[coreIdx].reset();
+        coreIdx++;
+    }
+    tracesAttached = false;
+
+    SimulationBinding binding(state.get());
+    initializeSimulation();
+    return nullptr;
+}
+
+bool Simulator::feed(int coreId, unsigned long long address, bool isWrite)
+{
+    if (coreId < 0 || coreId >= settings.cores || state->engineStarted)
+    {
+        return false;
+    }
+    fedTraces[coreId].push_back((address & ~TRACE_WRITE_FLAG) | (isWrite ? TRACE_WRITE_FLAG : 0));
+    return true;
+}
+
+void Simulator::attachTraces(const TraceView *views, TraceSource *const *sources)
+{
+    int coreIdx = 0;
+    while (coreIdx < settings.cores)
+    {
+        state->coreTraces[coreIdx] = views[coreIdx];
+        state->coreSources[coreIdx] = sources != nullptr ? sources[coreIdx] : nullptr;
+        coreIdx++;
+    }
+    tracesAttached = true;
+}
+
+void Simulator::installFedTraces()
+{
+    if (tracesAttached)
+    {
+        return;
+    }
+    int coreIdx = 0;
+    while (coreIdx < settings.cores)
+    {
+        state->coreTraces[coreIdx] = TraceView{fedTraces[coreIdx].data(), fedTraces[coreIdx].size()};
+        coreIdx++;
+    }
+}
+
+bool Simulator::step(long long cycles)
+{
+    SimulationBinding binding(state.get());
+
+    // Fed traces are final once the engine starts
+    if (!state->engineStarted)
+    {
+        installFedTraces();
+    }
+
+    long long targetCycle = cycles > LLONG_MAX - state->currentCycle ? LLONG_MAX : state->currentCycle + cycles;
+    auto hostStart = chrono::steady_clock::now();
+    unsigned long long ticksStart = readHostTicks();
+    bool active = advanceSimulation(targetCycle);
+    state->hostProfile.engineTicks += readHostTicks() - ticksStart;
+    state->hostProfile.engineSeconds += chrono::duration<double>(chrono::steady_clock::now() - hostStart).count();
+    return active;
+}
+
+// Accesses retired by every core of the bound simulation; sampling units
+// restart the counters, so a sampled run counts the accesses they used
+static long long retiredAccesses()
+{
+    const vector<long long> &sampled = sim->sampledAccesses;
+    long long retired = 0;
+    int coreIdx = 0;
+    while (coreIdx < sim->numCores)
+    {
+        retired += sim->samplePeriod > 0 ? sampled[coreIdx] : sim->executedInstructions[coreIdx];
+        coreIdx++;
+    }
+    return retired;
+}
+
+bool Simulator::stepAccesses(long long accesses)
+{
+    long long targetAccesses;
+    {
+        SimulationBinding binding(state.get());
+        targetAccesses = retiredAccesses() + accesses;
+    }
+
+    // A cycle (sampling unit) retires at most one access (period accesses)
+    // per core, so stepping by the remaining accesses over that never passes
+    // the target
+    long long accessesPerStep = settings.cores * (settings.samplePeriod > 0 ? settings.samplePeriod : 1);
+    bool active = true;
+    while (active)
+    {
+        long long remaining;
+        {
+            SimulationBinding binding(state.get());
+            remaining = targetAccesses - retiredAccesses();
+        }
+        if (remaining <= 0)
+        {
+            break;
+        }
+        active = step(max(1LL, remaining / accessesPerStep));
+    }
+    return active;
+}
+
+SimulationTiming Simulator::run()
+{
+    while (step(LLONG_MAX))
+    {
+    }
+    SimulationBinding binding(state.get());
+    return simulationTiming();
+}
+
+SimulatorStats Simulator::stats() const
+{
+    SimulationBinding binding(state.get());
+    SimulatorStats result;
+    result.cores.resize(settings.cores);
+    int coreIdx = 0;
+    while (coreIdx < settings.cores)
+    {
+        CoreStats &core = result.cores[coreIdx];
+        core.instructions = sim->executedInstructions[coreIdx];
+        core.reads = sim->readCount[coreIdx];
+        core.writes = sim->writeCount[coreIdx];
+        core.misses = sim->missCount[coreIdx];
+        core.evictions = sim->evictionCount[coreIdx];
+        core.writebacks = sim->writebackCount[coreIdx];
+        core.invalidations = sim->invalidationCount[coreIdx];
+        core.dataTraffic = sim->trafficBytes[coreIdx];
+        core.executionCycles = sim->totalCycles[coreIdx] + sim->executedInstructions[coreIdx];
+        core.stallCycles = sim->stalledCycles[coreIdx];
+        coreIdx++;
+    }
+    result.busTransactions = sim->busTransactionCount;
+    result.busTraffic = sim->totalBusTraffic;
+    result.busBusyCycles = sim->busBusyCycles;
+    result.snoopsAvoided = sim->snoopsAvoided;
+    result.runAheadConflicts = sim->runAheadConflicts;
+    result.quantumSlipCycles = sim->quantumSlipCycles;
+    result.llcHits = sim->llcHits;
+    result.llcMisses = sim->llcMisses;
+    result.llcBackInvalidations = sim->llcBackInvalidations;
+    result.memoryWritebacks = sim->memoryWritebacks;
+    result.timing = simulationTiming();
+    result.clock = sim->currentCycle;
+    result.finished = sim->engineStarted && !sim->simulationActive;
+    result.sampling = sim->samplePeriod > 0 ? samplingEstimates() : SamplingEstimates{};
+    result.host = sim->hostProfile;
+    return result;
+}
+
+void Simulator::printReport(ostream &output) const
+{
+    SimulationBinding binding(state.get());
+    printSimulationReport(output, simulationTiming());
+}
+
+bool Simulator::saveCheckpoint(const string &path) const
+{
+    ofstream outputFile(path, ios::binary | ios::trunc);
+    if (!outputFile)
+    {
+        return false;
+    }
+    SimulationBinding binding(state.get());
+    writeCheckpointHeader(outputFile, settings);
+    writeSimulationState(outputFile);
+    return outputFile.good();
+}
+
+const char *Simulator::restoreCheckpoint(const string &path)
+{
+    ifstream inputFile(path, ios::binary);
+    if (!inputFile)
+    {
+        return "Cannot open the checkpoint file.";
+    }
+    SimulatorConfig config;
+    const char *error = readCheckpointHeader(inputFile, config);
+    if (error != nullptr)
+    {
+        return error;
+    }
+
+    // Reconfiguring clears the traces; keep the ones given for the restore
+    TraceView views[MAX_CORES];
+    TraceSource *sources[MAX_CORES];
+    vector<PackedTraceEntry> fed[MAX_CORES];
+    bool attached = tracesAttached;
+    int coreIdx = 0;
+    while (coreIdx < MAX_CORES)
+    {
+        views[coreIdx] = state->coreTraces[coreIdx];
+        sources[coreIdx] = state->coreSources[coreIdx];
+        fed[coreIdx].swap(fedTraces[coreIdx]);
+        coreIdx++;
+    }
+    error = configure(config);
+    if (error != nullptr)
+    {
+        return error;
+    }
+    coreIdx = 0;
+    while (coreIdx < MAX_CORES)
+    {
+        state->coreTraces[coreIdx] = views[coreIdx];
+        state->coreSources[coreIdx] = sources[coreIdx];
+        fedTraces[coreIdx].swap(fed[coreIdx]);
+        coreIdx++;
+    }
+    tracesAttached = attached;
+    installFedTraces();
+
+    SimulationBinding binding(state.get());
+    error = readSimulationState(inputFile);
+    if (error != nullptr)
+    {
+        initializeSimulation();
+    }
+    return error;
+}
@@ -0,0 +1,187 @@
+#ifndef SIMULATOR_HPP
+#define SIMULATOR_HPP
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "main.hpp"
+
+using namespace std;
+
+struct SimulationState;
+class TraceSource;
+
+// Cache geometry and engine options of one simulator
+struct SimulatorConfig
+{
+    int cores = 4;              // 1..MAX_CORES
+    int setBits = 2;            // s: 2^s sets
+    int ways = 2;               // E: lines per set
+    int blockBits = 4;          // b: 2^b byte blocks
+    ReplacementPolicy policy = ReplacementPolicy::LRU;
+    bool eventDriven = false;   // Skip cycles in which every core waits on the bus
+    bool functional = false;    // Untimed MESI, no cycle counts
+    bool snoopFilter = false;   // Sharer directory limits snoops
+    int parallelThreads = 0;    // Quantum engine threads; 0 = serial engine
+    int quantumCycles = 1;      // Cycles between quantum engine barriers
+    long long fastForward = 0;  // Accesses per core to only warm the caches with first
+    long long region = 0;       // Accesses per core to simulate after that; 0 = all
+    long long samplePeriod = 0; // Accesses per core per sampling unit; 0 = no sampling
+    long long sampleWindow = 0; // Measured accesses per core in each unit
+    long long sampleWarmup = 0; // Detailed but unmeasured accesses before each window
+    int llcWays = 0;            // Shared LLC lines per set; 0 = no LLC, misses go to memory
+    int llcSetBits = 0;         // LLC: 2^s sets
+    int llcBlockBits = 6;       // LLC: 2^b byte blocks, at least the L1's
+    ReplacementPolicy llcPolicy = ReplacementPolicy::LRU;
+    LlcInclusion llcInclusion = LlcInclusion::INCLUSIVE;
+    int llcHitCycles = 20;      // Cycles of a block transfer from or to the LLC
+};
+
+// Counters of one core
+struct CoreStats
+{
+    long long instructions;
+    long long reads;
+    long long writes;
+    long long misses;
+    long long evictions;
+    long long writebacks;
+    long long invalidations;
+    long long dataTraffic;      // Bytes moved into or out of this core's cache
+    long long executionCycles;
+    long long stallCycles;
+};
+
+// Mean of a sampled quantity and the half-width of its 95% confidence
+// interval (negative with fewer than two units)
+struct SampleEstimate
+{
+    double value;
+    double halfWidth;
+};
+
+// Whole-run estimates of a sampled simulation
+struct SamplingEstimates
+{
+    int units;                          // Units with a measured window
+    long long measuredAccesses;         // Accesses in the measured windows, all cores
+    long long totalAccesses;            // Accesses in the sampled region, all cores
+    SampleEstimate simulationCycles;    // Cycles until every core finished
+    SampleEstimate missRate;            // Percent of accesses
+    SampleEstimate busTraffic;          // Bytes
+    vector<SampleEstimate> coreCycles;  // Execution cycles of each core
+};
+
+// Host-side stages the profiler times
+enum class HostPhase
+{
+    MEMORY_OPERATION,   // executeMemoryOperation
+    BUS_REQUEST,        // Granting a bus request, with its snoops
+    DATA_TRANSFER,      // Completing a bus data transfer
+    COUNT
+};
+
+// Host time spent simulating. Engine time is always measured; phase times
+// only in builds with L1SIM_PROFILE (make PROFILE=1).
+struct HostProfile
+{
+    double engineSeconds = 0.0;             // Wall time inside step() and run()
+    unsigned long long engineTicks = 0;     // Host cycle counter ticks of the same
+    unsigned long long phaseTicks[(int)HostPhase::COUNT] = {};
+    unsigned long long phaseCalls[(int)HostPhase::COUNT] = {};
+};
+
+// Counters of a whole simulation
+struct SimulatorStats
+{
+    vector<CoreStats> cores;
+    long long busTransactions;
+    long long busTraffic;
+    long long busBusyCycles;        // Cycles the bus spent transferring blocks
+    long long snoopsAvoided;
+    long long runAheadConflicts;
+    long long quantumSlipCycles;
+    long long llcHits;              // Memory-side fills the LLC served
+    long long llcMisses;            // Memory-side fills that went to memory
+    long long llcBackInvalidations; // L1 copies dropped by inclusive LLC evictions
+    long long memoryWritebacks;     // Dirty blocks written to memory
+    SimulationTiming timing;
+    long long clock;                // Cycles run so far (rounds in functional mode)
+    bool finished;
+    SamplingEstimates sampling;     // Sampled runs; the counters above then
+                                    // only cover the last unit's window
+    HostProfile host;               // Since configure() in this process; not checkpointed
+};
+
+// A self-contained multicore cache simulation. Each instance owns its
+// configuration, caches, bus and counters, so instances can run
+// concurrently on different threads; one instance must only be used by one
+// thread at a time. Tag matching uses the widest SIMD implementation the
+// host supports, chosen when the library loads; selectTagMatch (simd.hpp)
+// only overrides it for tests and benchmarks, while no instance runs.
+//
+//   Simulator simulator;
+//   simulator.configure(config);
+//   simulator.feed(0, 0x817b08, false);  ...
+//   simulator.run();
+//   SimulatorStats stats = simulator.stats();
+class Simulator
+{
+public:
+    Simulator();
+    ~Simulator();
+    Simulator(const Simulator &) = delete;
+    Simulator &operator=(const Simulator &) = delete;
+
+    // Apply a configuration and start over with empty traces; returns why
+    // the configuration is invalid (and keeps the old one), or null
+    const char *configure(const SimulatorConfig &config);
+    const SimulatorConfig &config() const { return settings; }
+
+    // Append an access to a core's trace; false if the core does not exist
+    // or the simulation has already started
+    bool feed(int coreId, unsigned long long address, bool isWrite);
+
+    // Read the cores' traces from memory the caller keeps alive instead of
+    // fed accesses. A non-null sources[k] produces core k's trace in windows
+    // and can be consumed by only one simulation.
+    void attachTraces(const TraceView *views, TraceSource *const *sources);
+
+    // Advance by up to cycles cycles (rounds of accesses in functional
+    // mode, sampling units when sampling); false once every core has finished
+    bool step(long long cycles);
+
+    // Advance until at least accesses more accesses have retired, stopping
+    // at the first cycle boundary that reaches the count; false once every
+    // core has finished
+    bool stepAccesses(long long accesses);
+
+    // Run to completion
+    SimulationTiming run();
+
+    SimulatorStats stats() const;
+
+    // The boxed report the command line prints
+    void printReport(ostream &output) const;
+
+    // Write the configuration and everything simulated so far to a
+    // checkpoint file; false if it cannot be written
+    bool saveCheckpoint(const string &path) const;
+
+    // Continue from a checkpoint: adopt its configuration and state. The
+    // traces it was taken on must be fed or attached first; returns why the
+    // checkpoint cannot be restored (leaving a fresh simulation), or null.
+    const char *restoreCheckpoint(const string &path);
+
+private:
+    // Point the cores at the fed traces unless traces were attached
+    void installFedTraces();
+
+    unique_ptr<SimulationState> state;
+    SimulatorConfig settings;
+    vector<PackedTraceEntry> fedTraces[MAX_CORES];
+    bool tracesAttached;
+};
+
+#endif // SIMULATOR_HPP
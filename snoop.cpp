@@ -0,0 +1,89 @@
+#include <vector>
+#include "snoop.hpp"
+
+using namespace std;
+
+void SharerDirectory::reset(size_t maxLines, int setBits)
+{
+    indexBits = setBits;
+
+    // Keep the load factor at or below one half
+    size_t capacity = 16;
+    while (capacity < 2 * maxLines)
+    {
+        capacity <<= 1;
+    }
+    table.assign(capacity, Entry{0, 0});
+    slotMask = capacity - 1;
+}
+
+size_t SharerDirectory::slotOf(unsigned long long blockKey) const
+{
+    // Probe from the home slot until the key or an empty slot
+    size_t slot = homeSlot(blockKey);
+    while (table[slot].blockKey != 0 && table[slot].blockKey != blockKey)
+    {
+        slot = (slot + 1) & slotMask;
+    }
+    return slot;
+}
+
+unsigned long long SharerDirectory::sharers(int setIndex, unsigned long long tag) const
+{
+    return table[slotOf(blockKeyOf(setIndex, tag))].sharerMask;
+}
+
+void SharerDirectory::addSharer(int coreId, int setIndex, unsigned long long tag)
+{
+    unsigned long long blockKey = blockKeyOf(setIndex, tag);
+    Entry &entry = table[slotOf(blockKey)];
+    entry.blockKey = blockKey;
+    entry.sharerMask |= 1ULL << coreId;
+}
+
+void SharerDirectory::removeSharer(int coreId, int setIndex, unsigned long long tag)
+{
+    size_t slot = slotOf(blockKeyOf(setIndex, tag));
+    if (table[slot].blockKey == 0)
+    {
+        return;
+    }
+    table[slot].sharerMask &= ~(1ULL << coreId);
+    if (table[slot].sharerMask != 0)
+    {
+        return;
+    }
+
+    // Last sharer gone: delete with backward shift so probe chains stay intact
+    size_t hole = slot;
+    size_t next = (hole + 1) & slotMask;
+    while (table[next].blockKey != 0)
+    {
+        size_t home = homeSlot(table[next].blockKey);
+        // Move the entry back if its home is not cyclically within (hole, next]
+        if (((next - home) & slotMask) >= ((next - hole) & slotMask))
+        {
+            table[hole] = table[next];
+            hole = next;
+        }
+        next = (next + 1) & slotMask;
+    }
+    table[hole] = Entry{0, 0};
+}
+
+void SharerDirectory::writeTo(ostream &output) const
+{
+    unsigned long long slotCount = table.size();
+    output.write((const char *)&slotCount, sizeof(slotCount));
+    output.write((const char *)table.data(), table.size() * sizeof(Entry));
+}
+
+bool SharerDirectory::readFrom(istream &input)
+{
+    unsigned long long slotCount = 0;
+    if (!input.read((char *)&slotCount, sizeof(slotCount)) || slotCount != table.size())
+    {
+        return false;
+    }
+    return (bool)input.read((char *)table.data(), table.size() * sizeof(Entry));
+}
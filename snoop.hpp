@@ -0,0 +1,57 @@
+#ifndef SNOOP_HPP
+#define SNOOP_HPP
+
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+// Sharer directory used as a snoop filter: for every block resident in at
+// least one L1 it records a bit mask of the cores holding a valid copy.
+// Kept exact on fills, evictions and invalidations so coherence actions can
+// visit only the real sharers instead of every peer cache.
+class SharerDirectory
+{
+public:
+    // Size the table for at most maxLines resident lines of caches with
+    // 2^setBits sets and clear it
+    void reset(size_t maxLines, int setBits);
+
+    // Cores holding a valid copy of the block (set, tag)
+    unsigned long long sharers(int setIndex, unsigned long long tag) const;
+
+    void addSharer(int coreId, int setIndex, unsigned long long tag);
+    void removeSharer(int coreId, int setIndex, unsigned long long tag);
+
+    // Raw table contents, for checkpoints; readFrom expects a table of the
+    // size the writer had
+    void writeTo(ostream &output) const;
+    bool readFrom(istream &input);
+
+private:
+    struct Entry
+    {
+        unsigned long long blockKey;    // blockKeyOf(set, tag); 0 = empty slot
+        unsigned long long sharerMask;  // Bit c = core c holds the block
+    };
+
+    // The block number plus one; block numbers stay below 2^63
+    unsigned long long blockKeyOf(int setIndex, unsigned long long tag) const
+    {
+        return ((tag << indexBits) | (unsigned int)setIndex) + 1;
+    }
+
+    // Fibonacci hashing spreads the strided keys of one set across the table
+    size_t homeSlot(unsigned long long blockKey) const
+    {
+        return (size_t)((blockKey * 0x9E3779B97F4A7C15ULL) >> 20) & slotMask;
+    }
+
+    size_t slotOf(unsigned long long blockKey) const;
+
+    vector<Entry> table;    // Open addressing, linear probing
+    size_t slotMask = 0;
+    int indexBits = 0;      // s of the caches
+};
+
+#endif // SNOOP_HPP
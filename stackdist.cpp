@@ -0,0 +1,357 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include "main.hpp"
+#include "trace.hpp"
+#include "stackdist.hpp"
+
+using namespace std;
+
+static const char BLOCK_MARK = 1;
+static const char HOLE_MARK = 2;
+
+void ReuseTree::addAt(unsigned int position, int delta)
+{
+    size_t index = position + 1;
+    while (index < fenwick.size())
+    {
+        fenwick[index] += delta;
+        index += index & (~index + 1);
+    }
+}
+
+unsigned int ReuseTree::prefixCount(unsigned int position) const
+{
+    // Marks at positions [0, position)
+    int count = 0;
+    size_t index = position;
+    while (index > 0)
+    {
+        count += fenwick[index];
+        index &= index - 1;
+    }
+    return count;
+}
+
+void ReuseTree::makeRoom()
+{
+    // Renumber the live marks 0..live-1 in timeline order and leave at least
+    // as many free positions, so compaction is amortized O(1) per access
+    size_t capacity = max<size_t>(16, 2 * (positionOf.size() + holes.size() + 1));
+    vector<unsigned long long> liveBlocks;
+    vector<char> liveMarks(capacity, 0);
+    liveBlocks.reserve(capacity);
+    holes.clear();
+    unsigned int position = 0;
+    while (position < nextPosition)
+    {
+        if (marked[position] == BLOCK_MARK)
+        {
+            positionOf[blockAt[position]] = liveBlocks.size();
+        }
+        else if (marked[position] == HOLE_MARK)
+        {
+            holes.insert(holes.end(), liveBlocks.size());
+        }
+        if (marked[position])
+        {
+            liveMarks[liveBlocks.size()] = marked[position];
+            liveBlocks.push_back(blockAt[position]);
+        }
+        position++;
+    }
+
+    nextPosition = liveBlocks.size();
+    liveBlocks.resize(capacity);
+    blockAt.swap(liveBlocks);
+    marked.swap(liveMarks);
+
+    // Linear-time Fenwick build over the marks
+    fenwick.assign(capacity + 1, 0);
+    size_t index = 1;
+    while (index <= capacity)
+    {
+        fenwick[index] += marked[index - 1] != 0;
+        size_t parent = index + (index & (~index + 1));
+        if (parent <= capacity)
+        {
+            fenwick[parent] += fenwick[index];
+        }
+        index++;
+    }
+}
+
+unsigned int ReuseTree::access(unsigned long long blockAddr)
+{
+    unsigned int distance = NOT_RESIDENT;
+    auto found = positionOf.find(blockAddr);
+    bool resident = found != positionOf.end();
+    unsigned int previous = resident ? found->second : 0;
+    if (resident)
+    {
+        distance = positionOf.size() + holes.size() - prefixCount(previous + 1);
+    }
+
+    // Fill the most recent hole if it is above the block; on a hit the hole
+    // moves down to the block's old place
+    if (!holes.empty() && (!resident || *holes.rbegin() > previous))
+    {
+        unsigned int hole = *holes.rbegin();
+        holes.erase(hole);
+        addAt(hole, -1);
+        marked[hole] = 0;
+        if (resident)
+        {
+            marked[previous] = HOLE_MARK;
+            holes.insert(previous);
+        }
+    }
+    else if (resident)
+    {
+        addAt(previous, -1);
+        marked[previous] = 0;
+    }
+
+    if (nextPosition == blockAt.size())
+    {
+        makeRoom();
+    }
+    unsigned int position = nextPosition++;
+    blockAt[position] = blockAddr;
+    marked[position] = BLOCK_MARK;
+    addAt(position, 1);
+    positionOf[blockAddr] = position;
+    return distance;
+}
+
+void ReuseTree::invalidate(unsigned long long blockAddr)
+{
+    auto found = positionOf.find(blockAddr);
+    if (found == positionOf.end())
+    {
+        return;
+    }
+    marked[found->second] = HOLE_MARK;
+    holes.insert(found->second);
+    positionOf.erase(found);
+}
+
+// Stack distance histogram of one core at one set count
+struct DistanceProfile
+{
+    vector<long long> distanceCounts;   // Hits at distance d < maxWays
+    long long farAccesses = 0;          // Resident but at distance >= maxWays
+};
+
+bool runMissCurves(int blockBits, int maxSetBits, int maxWays, const string &outputPath)
+{
+    int levelCount = maxSetBits + 1;
+
+    // Sets are created on first touch: trees[core][s][set]
+    vector<vector<vector<unique_ptr<ReuseTree>>>> trees(traceCoreCount);
+    vector<vector<DistanceProfile>> profiles(traceCoreCount);
+    vector<long long> accessCount(traceCoreCount, 0);
+    vector<long long> coldMisses(traceCoreCount, 0);
+    vector<long long> coherenceMisses(traceCoreCount, 0);
+    vector<unordered_set<unsigned long long>> invalidatedBlocks(traceCoreCount);
+    unordered_map<unsigned long long, unsigned long long> holderMask;
+
+    vector<TraceCursor> cursors(traceCoreCount);
+    int coreIdx = 0;
+    while (coreIdx < traceCoreCount)
+    {
+        trees[coreIdx].resize(levelCount);
+        profiles[coreIdx].resize(levelCount);
+        int level = 0;
+        while (level < levelCount)
+        {
+            trees[coreIdx][level].resize(1ULL << level);
+            profiles[coreIdx][level].distanceCounts.assign(maxWays, 0);
+            level++;
+        }
+        cursors[coreIdx] = openTraceCursor(loadedTraces[coreIdx], loadedSources[coreIdx]);
+        coreIdx++;
+    }
+
+    auto treeFor = [&](int core, int level, unsigned long long blockAddr) -> ReuseTree & {
+        unique_ptr<ReuseTree> &tree = trees[core][level][blockAddr & ((1ULL << level) - 1)];
+        if (!tree)
+        {
+            tree.reset(new ReuseTree());
+        }
+        return *tree;
+    };
+
+    // Round-robin interleaving, one access per unfinished core per round
+    bool anyActive = true;
+    while (anyActive)
+    {
+        anyActive = false;
+        coreIdx = 0;
+        while (coreIdx < traceCoreCount)
+        {
+            TraceCursor &cursor = cursors[coreIdx];
+            if (!cursor.hasEntry())
+            {
+                coreIdx++;
+                continue;
+            }
+            anyActive = true;
+
+            PackedTraceEntry entry = cursor.current();
+            unsigned long long blockAddr = (entry & ~TRACE_WRITE_FLAG) >> blockBits;
+            accessCount[coreIdx]++;
+
+            int level = 0;
+            unsigned int distance = ReuseTree::NOT_RESIDENT;
+            while (level < levelCount)
+            {
+                distance = treeFor(coreIdx, level, blockAddr).access(blockAddr);
+                DistanceProfile &profile = profiles[coreIdx][level];
+                if (distance < (unsigned int)maxWays)
+                {
+                    profile.distanceCounts[distance]++;
+                }
+                else if (distance != ReuseTree::NOT_RESIDENT)
+                {
+                    profile.farAccesses++;
+                }
+                level++;
+            }
+
+            // Not resident at any size: first touch, or lost to another core's write
+            if (distance == ReuseTree::NOT_RESIDENT)
+            {
+                if (invalidatedBlocks[coreIdx].erase(blockAddr))
+                {
+                    coherenceMisses[coreIdx]++;
+                }
+                else
+                {
+                    coldMisses[coreIdx]++;
+                }
+            }
+
+            unsigned long long &holders = holderMask[blockAddr];
+            if (entry & TRACE_WRITE_FLAG)
+            {
+                unsigned long long others = holders & ~(1ULL << coreIdx);
+                while (others != 0)
+                {
+                    int otherCore = __builtin_ctzll(others);
+                    others &= others - 1;
+                    level = 0;
+                    while (level < levelCount)
+                    {
+                        treeFor(otherCore, level, blockAddr).invalidate(blockAddr);
+                        level++;
+                    }
+                    invalidatedBlocks[otherCore].insert(blockAddr);
+                }
+                holders = 0;
+            }
+            holders |= 1ULL << coreIdx;
+
+            cursor.advance();
+            coreIdx++;
+        }
+    }
+
+    ofstream outputFile;
+    bool asJson = outputPath.size() >= 5 && outputPath.compare(outputPath.size() - 5, 5, ".json") == 0;
+    if (!outputPath.empty())
+    {
+        outputFile.open(outputPath);
+        if (!outputFile.is_open())
+        {
+            cerr << "Error: Could not open output file " << outputPath << endl;
+            return false;
+        }
+    }
+    ostream &output = outputPath.empty() ? cout : outputFile;
+    output << (asJson ? "[\n" : "core,s,E,cache_bytes,accesses,misses,miss_rate,cold_misses,coherence_misses\n");
+
+    // One curve per core, then the sum over all cores (core = -1)
+    bool firstRow = true;
+    int rowCore = 0;
+    while (rowCore <= traceCoreCount)
+    {
+        bool allCores = rowCore == traceCoreCount;
+        int firstCore = allCores ? 0 : rowCore;
+        int lastCore = allCores ? traceCoreCount - 1 : rowCore;
+
+        long long accesses = 0;
+        long long cold = 0;
+        long long coherence = 0;
+        coreIdx = firstCore;
+        while (coreIdx <= lastCore)
+        {
+            accesses += accessCount[coreIdx];
+            cold += coldMisses[coreIdx];
+            coherence += coherenceMisses[coreIdx];
+            coreIdx++;
+        }
+
+        int level = 0;
+        while (level < levelCount)
+        {
+            // Misses at E ways are the accesses at distance >= E
+            long long misses = cold + coherence;
+            coreIdx = firstCore;
+            while (coreIdx <= lastCore)
+            {
+                misses += profiles[coreIdx][level].farAccesses;
+                coreIdx++;
+            }
+            vector<long long> missesAt(maxWays + 1, misses);
+            int ways = maxWays - 1;
+            while (ways >= 1)
+            {
+                missesAt[ways] = missesAt[ways + 1];
+                coreIdx = firstCore;
+                while (coreIdx <= lastCore)
+                {
+                    missesAt[ways] += profiles[coreIdx][level].distanceCounts[ways];
+                    coreIdx++;
+                }
+                ways--;
+            }
+
+            ways = 1;
+            while (ways <= maxWays)
+            {
+                long long cacheBytes = (1LL << level) * ways * (1LL << blockBits);
+                double missRate = accesses > 0 ? (double)missesAt[ways] / accesses : 0.0;
+                output << fixed << setprecision(6);
+                if (asJson)
+                {
+                    output << (firstRow ? "" : ",\n") << "  {\"core\": " << (allCores ? -1 : rowCore)
+                           << ", \"s\": " << level << ", \"E\": " << ways << ", \"cache_bytes\": " << cacheBytes
+                           << ", \"accesses\": " << accesses << ", \"misses\": " << missesAt[ways]
+                           << ", \"miss_rate\": " << missRate << ", \"cold_misses\": " << cold
+                           << ", \"coherence_misses\": " << coherence << "}";
+                }
+                else
+                {
+                    output << (allCores ? -1 : rowCore) << "," << level << "," << ways << "," << cacheBytes << ","
+                           << accesses << "," << missesAt[ways] << "," << missRate << "," << cold << ","
+                           << coherence << "\n";
+                }
+                firstRow = false;
+                ways++;
+            }
+            level++;
+        }
+        rowCore++;
+    }
+    if (asJson)
+    {
+        output << "\n]\n";
+    }
+    return output.good();
+}
@@ -0,0 +1,57 @@
+#ifndef STACKDIST_HPP
+#define STACKDIST_HPP
+
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+
+using namespace std;
+
+// LRU stack of one cache set in one core. Every access takes the next
+// position on the set's timeline and a block is marked only at its latest
+// position, so the marks after a block's previous position count the
+// distinct blocks touched since then: its Mattson stack distance. A Fenwick
+// tree counts marks in O(log n); full timelines are compacted to the live
+// marks, so memory follows the set's footprint rather than trace length.
+//
+// An invalidated block leaves a hole: its mark stays, so deeper blocks keep
+// their distance, as the invalid line still holds its way. A miss fills the
+// most recent hole at every size that holds it. A hit deeper than that hole
+// is a miss at the sizes between them, so the hole takes the block's old
+// place and stays in the larger caches, where the access hit.
+class ReuseTree
+{
+public:
+    static const unsigned int NOT_RESIDENT = ~0u;
+
+    // Record an access and return its stack distance (0 = MRU), or
+    // NOT_RESIDENT if the block is not in the stack
+    unsigned int access(unsigned long long blockAddr);
+
+    // Turn a block's entry into a hole, e.g. on a coherence invalidation
+    void invalidate(unsigned long long blockAddr);
+
+private:
+    void addAt(unsigned int position, int delta);
+    unsigned int prefixCount(unsigned int position) const;
+    void makeRoom();
+
+    vector<int> fenwick;                    // 1-based Fenwick tree over positions
+    vector<unsigned long long> blockAt;     // Block whose latest access is at each position
+    vector<char> marked;                    // BLOCK_MARK, HOLE_MARK or 0
+    unsigned int nextPosition = 0;
+    unordered_map<unsigned long long, unsigned int> positionOf;
+    set<unsigned int> holes;                // Positions of the holes
+};
+
+// Run all cores' traces once, interleaved round-robin one access per core,
+// and write LRU miss-rate curves per core for every set count 2^0..2^maxSetBits
+// and associativity 1..maxWays with 2^blockBits byte blocks. A write leaves a
+// hole for the block in every other core's stacks, so the next access there is
+// a coherence miss at every cache size and the invalid line is refilled first,
+// as in the MESI model. The table goes to
+// outputPath (JSON for a .json name, else CSV) or to stdout if it is empty.
+bool runMissCurves(int blockBits, int maxSetBits, int maxWays, const string &outputPath);
+
+#endif // STACKDIST_HPP
@@ -0,0 +1,164 @@
+#ifndef STATE_HPP
+#define STATE_HPP
+
+#include <vector>
+#include <memory>
+#include "main.hpp"
+#include "bus.hpp"
+#include "snoop.hpp"
+#include "trace.hpp"
+#include "parallel.hpp"
+#include "sampling.hpp"
+#include "simulator.hpp"
+
+using namespace std;
+
+// Everything one simulation owns: configuration, trace inputs, caches, bus,
+// counters and the engine's progress. Simulator (simulator.hpp) owns one and
+// binds it to the calling thread while it runs; the engine functions in
+// cache.cpp, bus.cpp, parallel.cpp and simulator.cpp work on the state bound
+// to their thread, so separate simulations can run on separate threads.
+struct SimulationState
+{
+    // Configuration
+    int numCores = 4;               // Number of simulated cores (1..MAX_CORES)
+    int numSetBits = 2;             // Number of set index bits: total sets = 2^numSetBits
+    int numBlockBits = 4;           // Number of block offset bits: block size = 2^numBlockBits bytes
+    int associativity = 2;          // Number of lines per set (E-way associativity)
+    ReplacementPolicy replacementPolicy = ReplacementPolicy::LRU;
+    bool eventDrivenClock = false;  // Jump over cycles in which every core waits on the bus
+    bool functionalMode = false;    // Untimed: apply each access and its MESI transitions at once
+    bool snoopFilterEnabled = false;    // Probe only the sharers the directory records
+    int parallelThreads = 0;        // Host threads of the quantum engine; 0 = serial engine
+    int quantumCycles = 1;          // Cycles between quantum engine barriers
+    long long fastForwardAccesses = 0;  // Accesses per core applied untimed before the detailed region
+    long long regionAccesses = 0;       // Accesses per core in the detailed region; 0 = rest of trace
+    long long samplePeriod = 0;         // Accesses per core per sampling unit; 0 = no sampling
+    long long sampleWindow = 0;         // Measured accesses per core per unit
+    long long sampleWarmup = 0;         // Detailed, unmeasured accesses per core before each window
+    int llcWays = 0;                    // Shared LLC lines per set; 0 = no LLC
+    int llcSetBits = 0;
+    int llcBlockBits = 6;
+    ReplacementPolicy llcPolicy = ReplacementPolicy::LRU;
+    LlcInclusion llcInclusion = LlcInclusion::INCLUSIVE;
+    int llcHitCycles = 20;
+
+    // Per-core traces; views into memory owned by the caller, or window
+    // sources (streams, decoders) when non-null
+    TraceView coreTraces[MAX_CORES] = {};
+    TraceSource *coreSources[MAX_CORES] = {};
+    unique_ptr<TraceSource> regionLimits[MAX_CORES];    // End the detailed region of source-fed cores
+    unique_ptr<TraceSource> sampleLimits[MAX_CORES];    // End a sampling unit's detailed accesses
+
+    // Caches and snoop filter
+    CacheUnit processorCaches[MAX_CORES];
+    SharerDirectory sharerDirectory;
+    CacheUnit sharedCache;              // Shared LLC behind the bus (llc.hpp)
+
+    // Bus
+    RingQueue<BusTransaction> pendingRequests;
+    RingQueue<BusDataTransfer> dataTransferQueue;
+    vector<int> pendingOperations;      // -1, or 1 while a core waits on a granted bus operation
+    vector<bool> requestQueued;
+    unsigned long long allCoresMask = 0;
+    bool busOccupied = false;
+    long long busTickCounter = 0;
+    unsigned long long snoopedCoreMask = 0;    // Cores a snoop changed, for the quantum engine
+
+    // Statistics
+    vector<long long> executedInstructions;
+    vector<long long> totalCycles;
+    vector<long long> readCount;
+    vector<long long> writeCount;
+    vector<long long> missCount;
+    vector<long long> evictionCount;
+    vector<long long> writebackCount;
+    vector<long long> invalidationCount;
+    vector<long long> trafficBytes;
+    vector<long long> stalledCycles;
+    long long busTransactionCount = 0;
+    long long totalBusTraffic = 0;
+    long long busBusyCycles = 0;        // Bus ticks spent on a data transfer
+    long long snoopsAvoided = 0;        // Peer cache lookups the filter skipped
+    long long runAheadConflicts = 0;    // Snoops that hit a core already run past them
+    long long quantumSlipCycles = 0;    // Core cycles spent idle until a barrier
+    long long llcHits = 0;
+    long long llcMisses = 0;
+    long long llcBackInvalidations = 0;
+    long long memoryWritebacks = 0;
+    long long operationCounter = 0;
+    vector<long long> warmedAccesses;   // Accesses each core fast-forwarded over
+
+    // Engine progress, kept here so a run can be advanced in steps
+    vector<bool> processorRunning;
+    vector<TraceCursor> traceCursor;    // Position in each processor's trace
+    vector<TraceRecord> currentOp;      // Decoded entry at that position
+    vector<QuantumCore> quantumCores;   // Parallel engine run-ahead state
+    unique_ptr<QuantumWorkerPool> quantumWorkers;   // Its run-ahead threads, while a run is in progress
+    vector<SampleUnit> samples;         // Measured sampling units
+    vector<long long> sampledAccesses;  // Accesses of each core's region the sampling units used
+    bool engineStarted = false;
+    bool simulationActive = true;
+    long long currentCycle = 0;
+    long long peakCycles = 0;
+    int tagBytes = 4;                   // Width of the caches' stored tags
+
+    // Host time spent on this simulation (profile.hpp); not checkpointed
+    HostProfile hostProfile;
+};
+
+// The simulation bound to the calling thread
+extern thread_local SimulationState *sim;
+
+// Binds a simulation to the calling thread for the binding's lifetime
+class SimulationBinding
+{
+public:
+    explicit SimulationBinding(SimulationState *state) : previous(sim) { sim = state; }
+    ~SimulationBinding() { sim = previous; }
+    SimulationBinding(const SimulationBinding &) = delete;
+    SimulationBinding &operator=(const SimulationBinding &) = delete;
+
+private:
+    SimulationState *previous;
+};
+
+// Decode a packed entry for the bound simulation's s/b configuration
+inline TraceRecord decodeTraceEntry(PackedTraceEntry entry)
+{
+    return decodeTraceEntry(entry, sim->numSetBits, sim->numBlockBits);
+}
+
+// Reset the bound simulation's caches, bus, counters and progress
+void initializeSimulation();
+
+// Empty the caches and size their stored tags to tagBytes (4 or 8) bytes
+void initializeCaches(int tagBytes);
+
+// Zero every counter of the bound simulation
+void resetCounters();
+
+// Apply up to rounds accesses of every core from its trace cursor: cores take
+// turns one access at a time and each access settles its MESI transitions
+// at once, as in functional mode. Counts the accesses per core in applied.
+void warmCaches(long long rounds, vector<long long> &applied);
+
+// Cycle-by-cycle engine: every cycle each running core accesses its cache,
+// the bus advances one tick, and cores that are not stalled retire. Runs
+// until the clock reaches targetCycle or every core finishes; false once
+// finished.
+bool advanceSerialSimulation(long long targetCycle);
+
+// End a core's trace with its detailed region (--sim); regionPosition is
+// how far into the region the cursor already is
+void limitCoreRegion(int coreId, TraceCursor &cursor, unsigned long long regionPosition);
+
+// Advance the bound simulation until its clock reaches targetCycle (in
+// functional mode, that many rounds of accesses) or every core finishes;
+// false once finished
+bool advanceSimulation(long long targetCycle);
+
+// Cycle counts of the bound simulation so far
+SimulationTiming simulationTiming();
+
+#endif // STATE_HPP
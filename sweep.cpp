@@ -0,0 +1,391 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include "main.hpp"
+#include "cache.hpp"
+#include "trace.hpp"
+#include "simulator.hpp"
+#include "sweep.hpp"
+
+using namespace std;
+
+// Totals of one finished configuration
+struct SweepResult
+{
+    long long instructions;
+    long long reads;
+    long long writes;
+    long long misses;
+    long long evictions;
+    long long writebacks;
+    long long invalidations;
+    long long busTransactions;
+    long long busTraffic;
+    long long dataTraffic;
+    long long snoopsAvoided;
+    long long simulationCycles;
+    long long peakCycles;
+};
+
+// Parse "v", "lo-hi" or comma lists of either into values
+static bool parseIntList(const string &text, vector<int> &values)
+{
+    values.clear();
+    stringstream listStream(text);
+    string item;
+    while (getline(listStream, item, ','))
+    {
+        int low;
+        int high;
+        char separator;
+        stringstream itemStream(item);
+        if (!(itemStream >> low))
+        {
+            return false;
+        }
+        high = low;
+        if (itemStream >> separator && (separator != '-' || !(itemStream >> high) || high < low))
+        {
+            return false;
+        }
+        while (low <= high)
+        {
+            values.push_back(low++);
+        }
+    }
+    return !values.empty();
+}
+
+static bool parseSweepGrid(const string &spec, const SweepConfig &defaults, vector<SweepConfig> &configs)
+{
+    vector<int> setBits = {defaults.setBits};
+    vector<int> ways = {defaults.ways};
+    vector<int> blockBits = {defaults.blockBits};
+    vector<ReplacementPolicy> policies = {defaults.policy};
+
+    stringstream specStream(spec);
+    string dimension;
+    while (getline(specStream, dimension, ';'))
+    {
+        size_t equalsPos = dimension.find('=');
+        if (equalsPos == string::npos)
+        {
+            cerr << "Error: Sweep dimension " << dimension << " is not of the form key=values" << endl;
+            return false;
+        }
+        string key = dimension.substr(0, equalsPos);
+        string values = dimension.substr(equalsPos + 1);
+
+        bool parsed;
+        if (key == "s")
+        {
+            parsed = parseIntList(values, setBits);
+        }
+        else if (key == "E")
+        {
+            parsed = parseIntList(values, ways);
+        }
+        else if (key == "b")
+        {
+            parsed = parseIntList(values, blockBits);
+        }
+        else if (key == "r")
+        {
+            policies.clear();
+            stringstream policyStream(values);
+            string name;
+            parsed = true;
+            while (parsed && getline(policyStream, name, ','))
+            {
+                ReplacementPolicy policy;
+                parsed = parseReplacementPolicy(name, policy);
+                policies.push_back(policy);
+            }
+            parsed = parsed && !policies.empty();
+        }
+        else
+        {
+            cerr << "Error: Unknown sweep dimension " << key << " (use s, E, b or r)" << endl;
+            return false;
+        }
+        if (!parsed)
+        {
+            cerr << "Error: Bad values for sweep dimension " << key << ": " << values << endl;
+            return false;
+        }
+    }
+
+    for (int s : setBits)
+    {
+        for (int e : ways)
+        {
+            for (int b : blockBits)
+            {
+                for (ReplacementPolicy r : policies)
+                {
+                    configs.push_back(SweepConfig{s, e, b, r});
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static bool parseSweepList(const string &path, const SweepConfig &defaults, vector<SweepConfig> &configs)
+{
+    ifstream listFile(path);
+    if (!listFile.is_open())
+    {
+        cerr << "Error: Could not open sweep list " << path << endl;
+        return false;
+    }
+
+    string line;
+    int lineNumber = 0;
+    while (getline(listFile, line))
+    {
+        lineNumber++;
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        stringstream lineStream(line);
+        SweepConfig config = defaults;
+        string policyName;
+        if (!(lineStream >> config.setBits >> config.ways >> config.blockBits) ||
+            (lineStream >> policyName && !parseReplacementPolicy(policyName, config.policy)))
+        {
+            cerr << "Error: " << path << ":" << lineNumber << ": expected \"s E b [policy]\"" << endl;
+            return false;
+        }
+        configs.push_back(config);
+    }
+    return true;
+}
+
+bool parseSweepSpec(const string &spec, const SweepConfig &defaults, vector<SweepConfig> &configs)
+{
+    configs.clear();
+    bool parsed = spec.size() > 1 && spec[0] == '@'
+        ? parseSweepList(spec.substr(1), defaults, configs)
+        : parseSweepGrid(spec, defaults, configs);
+    if (!parsed)
+    {
+        return false;
+    }
+    if (configs.empty())
+    {
+        cerr << "Error: Sweep " << spec << " has no configurations" << endl;
+        return false;
+    }
+
+    // Reject bad points up front rather than after hours of simulation
+    for (const SweepConfig &config : configs)
+    {
+        const char *configError = geometryError(config.ways, config.policy);
+        if (config.setBits < 0 || config.blockBits < 1 || config.setBits + config.blockBits > 30)
+        {
+            configError = "Set and block bits must satisfy s >= 0, b >= 1, s + b <= 30.";
+        }
+        if (configError != nullptr)
+        {
+            cerr << "Error: Sweep point s=" << config.setBits << " E=" << config.ways << " b=" << config.blockBits
+                 << " " << replacementPolicyKey(config.policy) << ": " << configError << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Simulate one configuration of the base settings on the loaded traces;
+// returns why the simulator rejected the configuration, or null
+static const char *simulateConfig(const SweepConfig &config, const SimulatorConfig &base, SweepResult &result)
+{
+    SimulatorConfig settings = base;
+    settings.setBits = config.setBits;
+    settings.ways = config.ways;
+    settings.blockBits = config.blockBits;
+    settings.policy = config.policy;
+
+    Simulator simulator;
+    const char *configError = simulator.configure(settings);
+    if (configError != nullptr)
+    {
+        return configError;
+    }
+    simulator.attachTraces(loadedTraces, nullptr);
+    simulator.run();
+    SimulatorStats stats = simulator.stats();
+
+    result = SweepResult{};
+    for (const CoreStats &core : stats.cores)
+    {
+        result.instructions += core.instructions;
+        result.reads += core.reads;
+        result.writes += core.writes;
+        result.misses += core.misses;
+        result.evictions += core.evictions;
+        result.writebacks += core.writebacks;
+        result.invalidations += core.invalidations;
+        result.dataTraffic += core.dataTraffic;
+    }
+    result.busTransactions = stats.busTransactions;
+    result.busTraffic = stats.busTraffic;
+    result.snoopsAvoided = stats.snoopsAvoided;
+    result.simulationCycles = stats.timing.simulationCycles;
+    result.peakCycles = stats.timing.peakCycles;
+    return nullptr;
+}
+
+static const char *const resultColumns[] = {
+    "s", "E", "b", "policy", "cache_bytes", "instructions", "reads", "writes", "misses", "miss_rate",
+    "evictions", "writebacks", "invalidations", "bus_transactions", "bus_traffic", "data_traffic",
+    "snoops_avoided", "simulation_cycles", "max_exec_cycles"
+};
+
+// Row values in resultColumns order, already formatted
+static vector<string> formatResultRow(const SweepConfig &config, const SweepResult &result)
+{
+    long long cacheBytes = (1LL << config.setBits) * config.ways * (1LL << config.blockBits);
+    ostringstream missRate;
+    missRate << fixed << setprecision(6) << (result.instructions > 0 ? (double)result.misses / result.instructions : 0.0);
+
+    return {
+        to_string(config.setBits), to_string(config.ways), to_string(config.blockBits),
+        replacementPolicyKey(config.policy), to_string(cacheBytes), to_string(result.instructions),
+        to_string(result.reads), to_string(result.writes), to_string(result.misses), missRate.str(),
+        to_string(result.evictions), to_string(result.writebacks), to_string(result.invalidations),
+        to_string(result.busTransactions), to_string(result.busTraffic), to_string(result.dataTraffic),
+        to_string(result.snoopsAvoided), to_string(result.simulationCycles), to_string(result.peakCycles)
+    };
+}
+
+static void writeResultTable(ostream &output, bool asJson, const vector<SweepConfig> &configs,
+                             const vector<SweepResult> &results)
+{
+    const size_t columnCount = sizeof(resultColumns) / sizeof(resultColumns[0]);
+    if (!asJson)
+    {
+        size_t colIdx = 0;
+        while (colIdx < columnCount)
+        {
+            output << (colIdx ? "," : "") << resultColumns[colIdx];
+            colIdx++;
+        }
+        output << "\n";
+    }
+    else
+    {
+        output << "[\n";
+    }
+
+    size_t rowIdx = 0;
+    while (rowIdx < configs.size())
+    {
+        vector<string> row = formatResultRow(configs[rowIdx], results[rowIdx]);
+        size_t colIdx = 0;
+        if (asJson)
+        {
+            output << "  {";
+            while (colIdx < columnCount)
+            {
+                // Only the policy column is a string
+                bool quoted = colIdx == 3;
+                output << (colIdx ? ", " : "") << "\"" << resultColumns[colIdx] << "\": "
+                       << (quoted ? "\"" : "") << row[colIdx] << (quoted ? "\"" : "");
+                colIdx++;
+            }
+            output << (rowIdx + 1 < configs.size() ? "},\n" : "}\n");
+        }
+        else
+        {
+            while (colIdx < columnCount)
+            {
+                output << (colIdx ? "," : "") << row[colIdx];
+                colIdx++;
+            }
+            output << "\n";
+        }
+        rowIdx++;
+    }
+
+    if (asJson)
+    {
+        output << "]\n";
+    }
+}
+
+bool runSweep(const vector<SweepConfig> &configs, const SimulatorConfig &base, int workerCount, const string &outputPath)
+{
+    vector<SweepResult> results(configs.size());
+    atomic<size_t> nextConfig(0);
+    size_t finishedCount = 0;
+    bool rejected = false;
+    mutex progressLock;
+
+    // Workers claim configurations in order; each runs its own Simulator
+    // and only reads the shared traces
+    auto worker = [&]() {
+        size_t configIdx;
+        while ((configIdx = nextConfig++) < configs.size())
+        {
+            const char *configError = simulateConfig(configs[configIdx], base, results[configIdx]);
+
+            lock_guard<mutex> guard(progressLock);
+            finishedCount++;
+            const SweepConfig &config = configs[configIdx];
+            if (configError != nullptr)
+            {
+                cerr << "Error: Sweep point s=" << config.setBits << " E=" << config.ways << " b=" << config.blockBits
+                     << " " << replacementPolicyKey(config.policy) << ": " << configError << endl;
+                rejected = true;
+                continue;
+            }
+            cerr << "[" << finishedCount << "/" << configs.size() << "] s=" << config.setBits
+                 << " E=" << config.ways << " b=" << config.blockBits
+                 << " " << replacementPolicyKey(config.policy) << " done" << endl;
+        }
+    };
+
+    if (workerCount > (int)configs.size())
+    {
+        workerCount = configs.size();
+    }
+    vector<thread> workers;
+    int workerIdx = 0;
+    while (workerIdx < workerCount)
+    {
+        workers.emplace_back(worker);
+        workerIdx++;
+    }
+    for (thread &workerThread : workers)
+    {
+        workerThread.join();
+    }
+    if (rejected)
+    {
+        return false;
+    }
+
+    bool asJson = outputPath.size() >= 5 && outputPath.compare(outputPath.size() - 5, 5, ".json") == 0;
+    if (outputPath.empty())
+    {
+        writeResultTable(cout, false, configs, results);
+        return true;
+    }
+
+    ofstream outputFile(outputPath);
+    if (!outputFile.is_open())
+    {
+        cerr << "Error: Could not open output file " << outputPath << endl;
+        return false;
+    }
+    writeResultTable(outputFile, asJson, configs, results);
+    return outputFile.good();
+}
@@ -0,0 +1,31 @@
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include <string>
+#include <vector>
+#include "main.hpp"
+#include "simulator.hpp"
+
+using namespace std;
+
+// One cache configuration of a design-space sweep
+struct SweepConfig
+{
+    int setBits;                    // s
+    int ways;                       // E
+    int blockBits;                  // b
+    ReplacementPolicy policy;       // r
+};
+
+// Expand a sweep specification into configurations. Either a grid such as
+// "s=0-6;E=1,2,4;b=5;r=lru,srrip" (dimensions left out take the defaults) or
+// "@file" naming a list with one "s E b [policy]" per line.
+bool parseSweepSpec(const string &spec, const SweepConfig &defaults, vector<SweepConfig> &configs);
+
+// Simulate every configuration, on top of the base settings, on workerCount
+// threads that share the loaded traces, then write one result table to
+// outputPath: JSON for a .json name, CSV otherwise, CSV on stdout if the path
+// is empty
+bool runSweep(const vector<SweepConfig> &configs, const SimulatorConfig &base, int workerCount, const string &outputPath);
+
+#endif // SWEEP_HPP
@@ -0,0 +1,317 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+#include "main.hpp"
+#include "trace.hpp"
+#include "synthetic.hpp"
+
+using namespace std;
+
+// Records generated per window refill
+static const size_t SYNTHETIC_BLOCK_ENTRIES = 4096;
+
+// Width of a data word; scans and random patterns touch whole words
+static const unsigned long long WORD_BYTES = 8;
+
+// Zipf normalization terms summed exactly; the rest of the series is
+// approximated by its integral
+static const unsigned long long ZIPF_EXACT_TERMS = 1 << 16;
+
+static const char *const patternNames[] = {
+    "seq", "stride", "uniform", "zipf", "prodcons", "migratory", "lock", "falseshare"
+};
+
+static bool parsePattern(const string &name, SyntheticPattern &pattern)
+{
+    int patternIdx = 0;
+    while (patternIdx < (int)(sizeof(patternNames) / sizeof(patternNames[0])))
+    {
+        if (name == patternNames[patternIdx])
+        {
+            pattern = (SyntheticPattern)patternIdx;
+            return true;
+        }
+        patternIdx++;
+    }
+    return false;
+}
+
+static bool parseCount(const string &text, unsigned long long &value)
+{
+    char *parseEnd;
+    value = strtoull(text.c_str(), &parseEnd, 10);
+    return !text.empty() && text[0] != '-' && *parseEnd == '\0';
+}
+
+static bool parseFraction(const string &text, double &value)
+{
+    char *parseEnd;
+    value = strtod(text.c_str(), &parseEnd);
+    return !text.empty() && *parseEnd == '\0';
+}
+
+bool parseSyntheticSpec(const string &text, SyntheticSpec &spec)
+{
+    spec = SyntheticSpec();
+    bool footprintGiven = false;
+    stringstream specStream(text);
+    string field;
+    while (getline(specStream, field, ';'))
+    {
+        size_t equalsPos = field.find('=');
+        if (equalsPos == string::npos)
+        {
+            cerr << "Error: Synthetic workload field " << field << " is not of the form key=value" << endl;
+            return false;
+        }
+        string key = field.substr(0, equalsPos);
+        string value = field.substr(equalsPos + 1);
+
+        bool parsed;
+        if (key == "pattern")
+        {
+            parsed = parsePattern(value, spec.pattern);
+        }
+        else if (key == "n")
+        {
+            parsed = parseCount(value, spec.accesses) && spec.accesses > 0;
+        }
+        else if (key == "footprint")
+        {
+            parsed = parseCount(value, spec.footprint);
+            footprintGiven = true;
+        }
+        else if (key == "stride")
+        {
+            parsed = parseCount(value, spec.stride) && spec.stride > 0;
+        }
+        else if (key == "line")
+        {
+            parsed = parseCount(value, spec.lineBytes) && spec.lineBytes >= WORD_BYTES &&
+                     (spec.lineBytes & (spec.lineBytes - 1)) == 0;
+        }
+        else if (key == "write")
+        {
+            parsed = parseFraction(value, spec.writeFraction) && spec.writeFraction >= 0.0 && spec.writeFraction <= 1.0;
+        }
+        else if (key == "alpha")
+        {
+            parsed = parseFraction(value, spec.zipfSkew) && spec.zipfSkew > 0.0 && spec.zipfSkew < 1.0;
+        }
+        else if (key == "seed")
+        {
+            parsed = parseCount(value, spec.seed);
+        }
+        else
+        {
+            cerr << "Error: Unknown synthetic workload key " << key
+                 << " (use pattern, n, footprint, stride, line, write, alpha or seed)" << endl;
+            return false;
+        }
+        if (!parsed)
+        {
+            cerr << "Error: Bad value for synthetic workload key " << key << ": " << value << endl;
+            return false;
+        }
+    }
+
+    // False sharing is strongest on a single line unless asked otherwise
+    if (!footprintGiven && spec.pattern == SyntheticPattern::FALSE_SHARING)
+    {
+        spec.footprint = spec.lineBytes;
+    }
+    if (spec.footprint < spec.lineBytes || spec.footprint > (1ULL << 40))
+    {
+        cerr << "Error: Synthetic workload footprint must be between one line and 2^40 bytes" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Generates one core's accesses a window at a time. Every core has its own
+// random stream, derived from the seed and the core number.
+class SyntheticTraceSource : public TraceSource
+{
+public:
+    SyntheticTraceSource(const SyntheticSpec &spec, int coreId, int coreCount)
+        : spec(spec), coreId(coreId), generated(0),
+          randomState(spec.seed ^ (coreId + 1) * 0x9E3779B97F4A7C15ULL)
+    {
+        // Private regions are aligned apart above the shared one at 0
+        int regionBits = 64 - __builtin_clzll(spec.footprint - 1);
+        privateBase = (unsigned long long)(coreId + 1) << regionBits;
+        bool privateRegion = spec.pattern == SyntheticPattern::SEQUENTIAL || spec.pattern == SyntheticPattern::STRIDED ||
+                             spec.pattern == SyntheticPattern::UNIFORM || spec.pattern == SyntheticPattern::ZIPF;
+        unsigned long long addressLimit = privateRegion ? ((unsigned long long)(coreCount + 1) << regionBits)
+                                                        : max(spec.footprint, 2 * spec.lineBytes);
+        widestAddressBits = 64 - __builtin_clzll(addressLimit - 1);
+
+        lineCount = spec.footprint / spec.lineBytes;
+        wordCount = spec.footprint / WORD_BYTES;
+        if (spec.pattern == SyntheticPattern::ZIPF)
+        {
+            prepareZipf();
+        }
+    }
+
+    bool nextWindow(const PackedTraceEntry *&begin, const PackedTraceEntry *&end) override
+    {
+        size_t produced = 0;
+        while (produced < SYNTHETIC_BLOCK_ENTRIES && generated < spec.accesses)
+        {
+            window[produced++] = nextAccess();
+            generated++;
+        }
+        begin = window;
+        end = window + produced;
+        return produced > 0;
+    }
+
+    int addressBits() const override { return widestAddressBits; }
+
+private:
+    // splitmix64
+    unsigned long long nextRandom()
+    {
+        randomState += 0x9E3779B97F4A7C15ULL;
+        unsigned long long mixed = randomState;
+        mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBULL;
+        return mixed ^ (mixed >> 31);
+    }
+
+    double nextUniform() { return (nextRandom() >> 11) * (1.0 / 9007199254740992.0); }
+
+    PackedTraceEntry randomWrite(unsigned long long address)
+    {
+        return nextUniform() < spec.writeFraction ? address | TRACE_WRITE_FLAG : address;
+    }
+
+    static PackedTraceEntry access(unsigned long long address, bool isWrite)
+    {
+        return isWrite ? address | TRACE_WRITE_FLAG : address;
+    }
+
+    PackedTraceEntry nextAccess()
+    {
+        unsigned long long step = generated;
+        unsigned long long wordsPerLine = spec.lineBytes / WORD_BYTES;
+        switch (spec.pattern)
+        {
+        case SyntheticPattern::SEQUENTIAL:
+            return randomWrite(privateBase + (step % wordCount) * WORD_BYTES);
+        case SyntheticPattern::STRIDED:
+            return randomWrite(privateBase + (step * spec.stride) % spec.footprint);
+        case SyntheticPattern::UNIFORM:
+            return randomWrite(privateBase + nextRandom() % wordCount * WORD_BYTES);
+        case SyntheticPattern::ZIPF:
+        {
+            unsigned long long line = nextZipfRank();
+            return randomWrite(privateBase + line * spec.lineBytes + nextRandom() % wordsPerLine * WORD_BYTES);
+        }
+        case SyntheticPattern::PRODUCER_CONSUMER:
+        {
+            // Consumers read one line behind the word core 0 is writing
+            if (coreId == 0)
+            {
+                return access((step % wordCount) * WORD_BYTES, true);
+            }
+            unsigned long long lagged = step >= wordsPerLine ? step - wordsPerLine : 0;
+            return access((lagged % wordCount) * WORD_BYTES, false);
+        }
+        case SyntheticPattern::MIGRATORY:
+        {
+            // Read-modify-write of a block that moves to the next core each turn
+            unsigned long long line = (step / 2 + coreId) % lineCount;
+            return access(line * spec.lineBytes, step % 2 == 1);
+        }
+        case SyntheticPattern::LOCK:
+        {
+            // Test, set, update the protected counter in the next line, release
+            unsigned long long phase = step % 4;
+            return access(phase == 2 ? spec.lineBytes : 0, phase != 0);
+        }
+        case SyntheticPattern::FALSE_SHARING:
+        {
+            // Read-modify-write of this core's own word in each shared line
+            unsigned long long line = (step / 2) % lineCount;
+            return access(line * spec.lineBytes + (coreId % wordsPerLine) * WORD_BYTES, step % 2 == 1);
+        }
+        }
+        return 0;
+    }
+
+    // Zipfian ranks as in Gray et al., "Quickly Generating Billion-Record
+    // Synthetic Databases": rank 0 is the most frequent line
+    void prepareZipf()
+    {
+        double theta = spec.zipfSkew;
+        unsigned long long exactTerms = min(lineCount, ZIPF_EXACT_TERMS);
+        double zetaN = 0.0;
+        unsigned long long termIdx = 1;
+        while (termIdx <= exactTerms)
+        {
+            zetaN += pow((double)termIdx, -theta);
+            termIdx++;
+        }
+        if (lineCount > exactTerms)
+        {
+            double n = (double)lineCount;
+            double m = (double)exactTerms;
+            zetaN += (pow(n, 1.0 - theta) - pow(m, 1.0 - theta)) / (1.0 - theta) + (pow(n, -theta) - pow(m, -theta)) / 2.0;
+        }
+        zipfZetaN = zetaN;
+        zipfHalfPow = pow(0.5, theta);
+        zipfAlpha = 1.0 / (1.0 - theta);
+        zipfEta = (1.0 - pow(2.0 / lineCount, 1.0 - theta)) / (1.0 - (1.0 + zipfHalfPow) / zetaN);
+    }
+
+    unsigned long long nextZipfRank()
+    {
+        double u = nextUniform();
+        double uz = u * zipfZetaN;
+        if (uz < 1.0 || lineCount < 2)
+        {
+            return 0;
+        }
+        if (uz < 1.0 + zipfHalfPow)
+        {
+            return 1;
+        }
+        unsigned long long rank = (unsigned long long)(lineCount * pow(zipfEta * u - zipfEta + 1.0, zipfAlpha));
+        return rank < lineCount ? rank : lineCount - 1;
+    }
+
+    SyntheticSpec spec;
+    int coreId;
+    unsigned long long generated;           // Accesses produced so far
+    unsigned long long randomState;
+    unsigned long long privateBase;         // This core's region of the private patterns
+    unsigned long long lineCount;           // Lines in the footprint
+    unsigned long long wordCount;           // Words in the footprint
+    int widestAddressBits;
+    double zipfZetaN;
+    double zipfHalfPow;
+    double zipfAlpha;
+    double zipfEta;
+    PackedTraceEntry window[SYNTHETIC_BLOCK_ENTRIES];
+};
+
+TraceSource *createSyntheticSource(const SyntheticSpec &spec, int coreId, int coreCount)
+{
+    return new SyntheticTraceSource(spec, coreId, coreCount);
+}
+
+void openSyntheticTraces(const SyntheticSpec &spec)
+{
+    releaseTraces();
+    int coreIdx = 0;
+    while (coreIdx < traceCoreCount)
+    {
+        installTraceSource(coreIdx, createSyntheticSource(spec, coreIdx, traceCoreCount));
+        coreIdx++;
+    }
+}
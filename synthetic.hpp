@@ -0,0 +1,48 @@
+#ifndef SYNTHETIC_HPP
+#define SYNTHETIC_HPP
+
+#include <string>
+#include "main.hpp"
+#include "trace.hpp"
+
+using namespace std;
+
+// Access patterns of the synthetic workload generator (--synthetic)
+enum class SyntheticPattern
+{
+    SEQUENTIAL,         // seq: each core scans its own region word by word
+    STRIDED,            // stride: each core scans its own region in strides
+    UNIFORM,            // uniform: uniformly random words of each core's region
+    ZIPF,               // zipf: Zipfian random blocks of each core's region
+    PRODUCER_CONSUMER,  // prodcons: core 0 fills a shared buffer the others read
+    MIGRATORY,          // migratory: shared blocks read then written by each core in turn
+    LOCK,               // lock: every core acquires and releases one shared lock
+    FALSE_SHARING       // falseshare: each core writes its own word of shared blocks
+};
+
+// A synthetic workload, written as "pattern=zipf;n=1000000;footprint=1048576"
+// with any of the keys below. Streams are generated on the fly from the
+// seed, so the same specification always gives the same accesses.
+struct SyntheticSpec
+{
+    SyntheticPattern pattern = SyntheticPattern::UNIFORM;
+    unsigned long long accesses = 1000000;      // n: accesses per core
+    unsigned long long footprint = 1 << 20;     // Bytes of each core's region, or of the shared one
+    unsigned long long stride = 64;             // Bytes between stride accesses
+    unsigned long long lineBytes = 64;          // line: sharing granularity of the sharing patterns
+    double writeFraction = 0.3;                 // write: share of writes for seq, stride, uniform, zipf
+    double zipfSkew = 0.99;                     // alpha: Zipf exponent, in (0, 1)
+    unsigned long long seed = 1;
+};
+
+// Parse a specification; prints the problem and returns false if it is bad
+bool parseSyntheticSpec(const string &text, SyntheticSpec &spec);
+
+// Generator of one core's accesses; the caller owns it
+TraceSource *createSyntheticSource(const SyntheticSpec &spec, int coreId, int coreCount);
+
+// Install a generator for each of the traceCoreCount cores in place of
+// loaded traces
+void openSyntheticTraces(const SyntheticSpec &spec);
+
+#endif // SYNTHETIC_HPP
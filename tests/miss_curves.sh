@@ -0,0 +1,51 @@
+#!/bin/bash
+# Checks --miss-curves against --functional runs of the same traces: the
+# all-core miss count of every (s, E) row must equal the functional model's.
+# usage: tests/miss_curves.sh [simulator binary]
+
+SIM=${1:-./L1simulate}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+FAILED=0
+
+# compare <prefix> <cores> <block bits> <max s> <max E>
+compare()
+{
+    "$SIM" -t "$1" -n "$2" -b "$3" --miss-curves "$4,$5" | awk -F, '$1 == -1 { print $2, $3, $6 }' > "$WORK/curve"
+    while read -r s e misses; do
+        functional=$("$SIM" -t "$1" -n "$2" -s "$s" -E "$e" -b "$3" --functional 2>/dev/null |
+            awk '/Total Cache Misses/ { print $(NF - 1) }')
+        if [ "$functional" != "$misses" ]; then
+            echo "FAIL $(basename "$1") -n $2 -s $s -E $e -b $3: curve $misses, functional $functional"
+            FAILED=1
+        fi
+    done < "$WORK/curve"
+}
+
+# Core 1's write invalidates a block core 0 has already evicted: every
+# access misses in a 1-way cache
+printf 'R 0x40\nR 0x60\nW 0x20\nR 0x0\nR 0x60\nW 0x0\n' > "$WORK/evicted_proc0.trace"
+printf 'R 0x40\nW 0x20\nR 0x40\nR 0x0\nW 0x40\nR 0x20\n' > "$WORK/evicted_proc1.trace"
+compare "$WORK/evicted" 2 5 0 2
+
+# Four cores reading and writing a few dozen shared blocks
+RANDOM=7
+core=0
+while [ $core -lt 4 ]; do
+    access=0
+    while [ $access -lt 400 ]; do
+        op=R
+        if [ $((RANDOM % 5)) -lt 2 ]; then
+            op=W
+        fi
+        printf '%s 0x%x\n' $op $(((RANDOM % 40) * 16))
+        access=$((access + 1))
+    done > "$WORK/shared_proc$core.trace"
+    core=$((core + 1))
+done
+compare "$WORK/shared" 4 4 3 4
+
+if [ $FAILED -eq 0 ]; then
+    echo "miss curves: ok"
+fi
+exit $FAILED
@@ -0,0 +1,638 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "main.hpp"
+#include "trace.hpp"
+
+using namespace std;
+
+// Active binary trace mapping
+static void *mappedTraceBase = nullptr;
+static size_t mappedTraceSize = 0;
+
+// Double-buffered chunk reader. The worker thread fills one buffer while the
+// simulator consumes the other; a buffer is handed back when the cursor
+// moves past its end, so at most two chunks per core are ever resident.
+class TraceStream : public TraceSource
+{
+public:
+    explicit TraceStream(size_t chunkEntries)
+        : chunkSize(chunkEntries), consumerBuffer(-1), producerDone(false), stopRequested(false),
+          textSource(true), binaryFd(-1), binaryOffset(0), binaryRemaining(0)
+    {
+        int bufIdx = 0;
+        while (bufIdx < 2)
+        {
+            buffers[bufIdx].resize(chunkSize);
+            filled[bufIdx] = 0;
+            ready[bufIdx] = false;
+            bufIdx++;
+        }
+    }
+
+    ~TraceStream()
+    {
+        {
+            lock_guard<mutex> guard(stateLock);
+            stopRequested = true;
+        }
+        stateChanged.notify_all();
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+        if (binaryFd >= 0)
+        {
+            close(binaryFd);
+        }
+    }
+
+    bool openText(const string &path)
+    {
+        textInput.open(path);
+        textSource = true;
+        return textInput.is_open();
+    }
+
+    bool openBinary(const string &path, unsigned long long fileOffset, unsigned long long recordCount)
+    {
+        binaryFd = open(path.c_str(), O_RDONLY);
+        textSource = false;
+        binaryOffset = fileOffset;
+        binaryRemaining = recordCount;
+        return binaryFd >= 0;
+    }
+
+    void start()
+    {
+        worker = thread(&TraceStream::producerLoop, this);
+    }
+
+    // Release the buffer being read and wait for the next filled one
+    bool nextWindow(const PackedTraceEntry *&begin, const PackedTraceEntry *&end) override
+    {
+        unique_lock<mutex> guard(stateLock);
+        int nextBuffer = 0;
+        if (consumerBuffer >= 0)
+        {
+            ready[consumerBuffer] = false;
+            nextBuffer = consumerBuffer ^ 1;
+            stateChanged.notify_all();
+        }
+        stateChanged.wait(guard, [&] { return ready[nextBuffer] || producerDone; });
+
+        if (!ready[nextBuffer] || filled[nextBuffer] == 0)
+        {
+            return false;
+        }
+        consumerBuffer = nextBuffer;
+        begin = buffers[nextBuffer].data();
+        end = begin + filled[nextBuffer];
+        return true;
+    }
+
+private:
+    void producerLoop()
+    {
+        int fillBuffer = 0;
+        while (true)
+        {
+            {
+                unique_lock<mutex> guard(stateLock);
+                stateChanged.wait(guard, [&] { return !ready[fillBuffer] || stopRequested; });
+                if (stopRequested)
+                {
+                    break;
+                }
+            }
+
+            // The buffer is owned by this thread until it is marked ready
+            size_t count = textSource ? fillText(buffers[fillBuffer]) : fillBinary(buffers[fillBuffer]);
+
+            lock_guard<mutex> guard(stateLock);
+            filled[fillBuffer] = count;
+            ready[fillBuffer] = true;
+            if (count < chunkSize)
+            {
+                break;
+            }
+            stateChanged.notify_all();
+            fillBuffer ^= 1;
+        }
+
+        lock_guard<mutex> guard(stateLock);
+        producerDone = true;
+        stateChanged.notify_all();
+    }
+
+    size_t fillText(vector<PackedTraceEntry> &buffer)
+    {
+        size_t count = 0;
+        string currentLine;
+        while (count < chunkSize && getline(textInput, currentLine))
+        {
+            if (parseTraceLine(currentLine, buffer[count]))
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    size_t fillBinary(vector<PackedTraceEntry> &buffer)
+    {
+        size_t count = min<unsigned long long>(chunkSize, binaryRemaining);
+        size_t bytesWanted = count * sizeof(PackedTraceEntry);
+        size_t bytesRead = 0;
+        while (bytesRead < bytesWanted)
+        {
+            ssize_t result = pread(binaryFd, (char *)buffer.data() + bytesRead,
+                                   bytesWanted - bytesRead, binaryOffset + bytesRead);
+            if (result <= 0)
+            {
+                break;
+            }
+            bytesRead += result;
+        }
+        count = bytesRead / sizeof(PackedTraceEntry);
+        binaryOffset += bytesRead;
+        binaryRemaining -= count;
+        return count;
+    }
+
+    size_t chunkSize;
+    vector<PackedTraceEntry> buffers[2];
+    size_t filled[2];
+    bool ready[2];
+    int consumerBuffer;
+    bool producerDone;
+    bool stopRequested;
+    mutex stateLock;
+    condition_variable stateChanged;
+    thread worker;
+
+    bool textSource;
+    ifstream textInput;
+    int binaryFd;
+    unsigned long long binaryOffset;
+    unsigned long long binaryRemaining;
+};
+
+int traceCoreCount = 4;
+vector<PackedTraceEntry> processorTraces[MAX_CORES];
+TraceView loadedTraces[MAX_CORES];
+TraceSource *loadedSources[MAX_CORES] = {};
+
+void installTraceSource(int coreId, TraceSource *source)
+{
+    delete loadedSources[coreId];
+    loadedSources[coreId] = source;
+}
+
+bool refillTraceWindow(TraceCursor &cursor)
+{
+    if (cursor.source == nullptr || !cursor.source->nextWindow(cursor.position, cursor.windowEnd))
+    {
+        cursor.position = cursor.windowEnd;
+        return false;
+    }
+    return true;
+}
+
+bool parseTraceLine(const string &line, PackedTraceEntry &entry)
+{
+    // Skip empty lines and comments
+    if (line.empty() || line[0] == '#')
+    {
+        return false;
+    }
+
+    // Parse format: "R 0x817b08" or "W 0x817b08"
+    istringstream lineParser(line);
+    char operation;
+    string hexAddress;
+
+    if (!(lineParser >> operation >> hexAddress) || (operation != 'R' && operation != 'W'))
+    {
+        return false;
+    }
+
+    entry = stoull(hexAddress, nullptr, 16) & ~TRACE_WRITE_FLAG;
+    if (operation == 'W')
+    {
+        entry |= TRACE_WRITE_FLAG;
+    }
+    return true;
+}
+
+// Load trace files for all traceCoreCount processors
+bool loadProcessorTraces(const string &appPrefix)
+{
+    int procIdx = 0;
+    while (procIdx < traceCoreCount)
+    {
+        // Build filename: app1_proc0.trace, app1_proc1.trace, etc.
+        string traceFilename = appPrefix + "_proc" + to_string(procIdx) + ".trace";
+        ifstream inputFile(traceFilename);
+
+        if (!inputFile.is_open())
+        {
+            cerr << "Error: Could not open trace file " << traceFilename << endl;
+            return false;
+        }
+
+        processorTraces[procIdx].clear();
+
+        string currentLine;
+        PackedTraceEntry entry;
+        while (getline(inputFile, currentLine))
+        {
+            if (parseTraceLine(currentLine, entry))
+            {
+                processorTraces[procIdx].push_back(entry);
+            }
+        }
+
+        inputFile.close();
+        loadedTraces[procIdx] = TraceView{processorTraces[procIdx].data(), processorTraces[procIdx].size()};
+        procIdx++;
+    }
+
+    return true;
+}
+
+bool openTraceStreams(const string &source, size_t chunkEntries)
+{
+    releaseTraces();
+
+    // Binary source: locate each core's record block from the header
+    vector<unsigned long long> recordCounts;
+    unsigned long long recordOffset = 0;
+    TraceFileKind sourceKind = detectTraceFile(source);
+    if (sourceKind == TraceFileKind::COMPRESSED)
+    {
+        cerr << "Error: --stream reads text or binary traces; compressed traces are decoded in place" << endl;
+        return false;
+    }
+    bool binarySource = sourceKind == TraceFileKind::BINARY;
+    if (binarySource)
+    {
+        ifstream inputFile(source, ios::binary);
+        TraceFileHeader header;
+        recordCounts.assign(traceCoreCount, 0);
+        if (!inputFile.read((char *)&header, sizeof(header)) ||
+            header.version != TRACE_FILE_VERSION || header.coreCount != (unsigned int)traceCoreCount ||
+            !inputFile.read((char *)recordCounts.data(), traceCoreCount * sizeof(unsigned long long)))
+        {
+            cerr << "Error: " << source << " is not a version " << TRACE_FILE_VERSION
+                 << " binary trace for " << traceCoreCount << " cores" << endl;
+            return false;
+        }
+        recordOffset = sizeof(header) + traceCoreCount * sizeof(unsigned long long);
+    }
+
+    int procIdx = 0;
+    while (procIdx < traceCoreCount)
+    {
+        TraceStream *stream = new TraceStream(chunkEntries);
+        bool opened;
+        if (binarySource)
+        {
+            opened = stream->openBinary(source, recordOffset, recordCounts[procIdx]);
+            recordOffset += recordCounts[procIdx] * sizeof(PackedTraceEntry);
+        }
+        else
+        {
+            opened = stream->openText(source + "_proc" + to_string(procIdx) + ".trace");
+        }
+
+        if (!opened)
+        {
+            cerr << "Error: Could not open trace file for core " << procIdx << " from " << source << endl;
+            delete stream;
+            releaseTraces();
+            return false;
+        }
+        stream->start();
+        installTraceSource(procIdx, stream);
+        procIdx++;
+    }
+
+    return true;
+}
+
+void materializeTraces()
+{
+    int procIdx = 0;
+    while (procIdx < traceCoreCount)
+    {
+        if (loadedSources[procIdx] != nullptr)
+        {
+            vector<PackedTraceEntry> &entries = processorTraces[procIdx];
+            entries.clear();
+            const PackedTraceEntry *windowBegin;
+            const PackedTraceEntry *windowEnd;
+            while (loadedSources[procIdx]->nextWindow(windowBegin, windowEnd))
+            {
+                entries.insert(entries.end(), windowBegin, windowEnd);
+            }
+            installTraceSource(procIdx, nullptr);
+            loadedTraces[procIdx] = TraceView{entries.data(), entries.size()};
+        }
+        procIdx++;
+    }
+}
+
+TraceCursor openTraceCursor(const TraceView &view, TraceSource *source)
+{
+    TraceCursor cursor;
+    cursor.source = source;
+    if (cursor.source != nullptr)
+    {
+        cursor.position = cursor.windowEnd = nullptr;
+        refillTraceWindow(cursor);
+    }
+    else
+    {
+        cursor.position = view.entries;
+        cursor.windowEnd = view.entries + view.length;
+    }
+    return cursor;
+}
+
+int traceAddressBits(const TraceView &view, const TraceSource *source)
+{
+    if (source != nullptr)
+    {
+        return source->addressBits();
+    }
+    PackedTraceEntry allBits = 0;
+    size_t entryIdx = 0;
+    while (entryIdx < view.length)
+    {
+        allBits |= view.entries[entryIdx];
+        entryIdx++;
+    }
+    allBits &= ~TRACE_WRITE_FLAG;
+    return allBits == 0 ? 0 : 64 - __builtin_clzll(allBits);
+}
+
+bool seekTraceCursor(TraceCursor &cursor, unsigned long long index)
+{
+    // Whole windows are skipped at once; sources only read forward
+    while (index > 0 && cursor.hasEntry())
+    {
+        unsigned long long windowLeft = cursor.windowEnd - cursor.position;
+        if (index < windowLeft)
+        {
+            cursor.position += index;
+            return true;
+        }
+        index -= windowLeft;
+        cursor.position = cursor.windowEnd;
+        refillTraceWindow(cursor);
+    }
+    return index == 0;
+}
+
+// Passes on at most a fixed number of entries of another source
+class LimitedTraceSource : public TraceSource
+{
+public:
+    LimitedTraceSource(TraceSource *inner, unsigned long long entries) : inner(inner), remaining(entries), innerEnd(nullptr) {}
+
+    bool nextWindow(const PackedTraceEntry *&begin, const PackedTraceEntry *&end) override
+    {
+        if (remaining == 0 || !inner->nextWindow(begin, end))
+        {
+            return false;
+        }
+        innerEnd = end;
+        if ((unsigned long long)(end - begin) > remaining)
+        {
+            end = begin + remaining;
+        }
+        remaining -= end - begin;
+        return true;
+    }
+
+    // End of the last window taken from the inner source, before the cut;
+    // null until the first one
+    const PackedTraceEntry *uncutEnd() const { return innerEnd; }
+
+private:
+    TraceSource *inner;
+    unsigned long long remaining;
+    const PackedTraceEntry *innerEnd;
+};
+
+void limitTraceCursor(TraceCursor &cursor, unsigned long long entries, unique_ptr<TraceSource> &limiter)
+{
+    unsigned long long windowLeft = cursor.windowEnd - cursor.position;
+    if (entries <= windowLeft)
+    {
+        cursor.windowEnd = cursor.position + entries;
+        cursor.source = nullptr;
+        return;
+    }
+    if (cursor.source != nullptr)
+    {
+        limiter.reset(new LimitedTraceSource(cursor.source, entries - windowLeft));
+        cursor.source = limiter.get();
+    }
+}
+
+void unlimitTraceCursor(TraceCursor &cursor, const TraceCursor &unlimited, unique_ptr<TraceSource> &limiter)
+{
+    // Until the limiter hands out a window the cursor is in the unlimited one
+    const PackedTraceEntry *uncutEnd = nullptr;
+    if (limiter != nullptr && cursor.source == limiter.get())
+    {
+        uncutEnd = static_cast<LimitedTraceSource *>(limiter.get())->uncutEnd();
+    }
+    cursor.windowEnd = uncutEnd != nullptr ? uncutEnd : unlimited.windowEnd;
+    cursor.source = unlimited.source;
+    limiter.reset();
+
+    // A limit that ended on a window boundary left the next window unread
+    if (!cursor.hasEntry())
+    {
+        refillTraceWindow(cursor);
+    }
+}
+
+TraceFileKind detectTraceFile(const string &path)
+{
+    ifstream inputFile(path, ios::binary);
+    char magic[sizeof(TRACE_FILE_MAGIC)];
+    if (!inputFile.read(magic, sizeof(magic)))
+    {
+        return TraceFileKind::TEXT;
+    }
+    if (memcmp(magic, TRACE_FILE_MAGIC, sizeof(magic)) == 0)
+    {
+        return TraceFileKind::BINARY;
+    }
+    if (memcmp(magic, COMPRESSED_TRACE_MAGIC, sizeof(magic)) == 0)
+    {
+        return TraceFileKind::COMPRESSED;
+    }
+    return TraceFileKind::TEXT;
+}
+
+bool mapTraceFile(const string &path, const char *&base, size_t &size)
+{
+    int fileDesc = open(path.c_str(), O_RDONLY);
+    if (fileDesc < 0)
+    {
+        cerr << "Error: Could not open trace file " << path << endl;
+        return false;
+    }
+
+    struct stat fileInfo;
+    if (fstat(fileDesc, &fileInfo) != 0 || (size_t)fileInfo.st_size < sizeof(TraceFileHeader))
+    {
+        cerr << "Error: Trace file " << path << " is truncated" << endl;
+        close(fileDesc);
+        return false;
+    }
+
+    size_t fileSize = fileInfo.st_size;
+    void *mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDesc, 0);
+    close(fileDesc);
+    if (mapping == MAP_FAILED)
+    {
+        cerr << "Error: Could not map trace file " << path << endl;
+        return false;
+    }
+    madvise(mapping, fileSize, MADV_SEQUENTIAL);
+
+    releaseTraces();
+    mappedTraceBase = mapping;
+    mappedTraceSize = fileSize;
+    base = (const char *)mapping;
+    size = fileSize;
+    return true;
+}
+
+bool mapBinaryTrace(const string &path)
+{
+    const char *base;
+    size_t fileSize;
+    if (!mapTraceFile(path, base, fileSize))
+    {
+        return false;
+    }
+
+    const TraceFileHeader *header = (const TraceFileHeader *)base;
+    if (memcmp(header->magic, TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC)) != 0 ||
+        header->version != TRACE_FILE_VERSION || header->coreCount != (unsigned int)traceCoreCount)
+    {
+        cerr << "Error: " << path << " is not a version " << TRACE_FILE_VERSION
+             << " binary trace for " << traceCoreCount << " cores" << endl;
+        releaseTraces();
+        return false;
+    }
+
+    // Validate record counts against the file size before exposing any views
+    const unsigned long long *recordCounts = (const unsigned long long *)(header + 1);
+    size_t offset = sizeof(TraceFileHeader) + header->coreCount * sizeof(unsigned long long);
+    bool sizeValid = fileSize >= offset;
+    size_t expectedSize = offset;
+    unsigned int coreIdx = 0;
+    while (sizeValid && coreIdx < header->coreCount)
+    {
+        sizeValid = recordCounts[coreIdx] <= fileSize / sizeof(PackedTraceEntry);
+        expectedSize += recordCounts[coreIdx] * sizeof(PackedTraceEntry);
+        coreIdx++;
+    }
+    if (!sizeValid || expectedSize != fileSize)
+    {
+        cerr << "Error: Binary trace " << path << " size does not match its header" << endl;
+        releaseTraces();
+        return false;
+    }
+
+    coreIdx = 0;
+    while (coreIdx < header->coreCount)
+    {
+        loadedTraces[coreIdx] = TraceView{(const PackedTraceEntry *)(base + offset), recordCounts[coreIdx]};
+        offset += recordCounts[coreIdx] * sizeof(PackedTraceEntry);
+        coreIdx++;
+    }
+
+    return true;
+}
+
+bool convertTextTraces(const string &appPrefix, const string &outputPath)
+{
+    if (!loadProcessorTraces(appPrefix))
+    {
+        return false;
+    }
+
+    ofstream outputFile(outputPath, ios::binary | ios::trunc);
+    if (!outputFile.is_open())
+    {
+        cerr << "Error: Could not open output file " << outputPath << endl;
+        return false;
+    }
+
+    TraceFileHeader header;
+    memcpy(header.magic, TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC));
+    header.version = TRACE_FILE_VERSION;
+    header.coreCount = traceCoreCount;
+    outputFile.write((const char *)&header, sizeof(header));
+
+    int coreIdx = 0;
+    while (coreIdx < traceCoreCount)
+    {
+        unsigned long long recordCount = loadedTraces[coreIdx].length;
+        outputFile.write((const char *)&recordCount, sizeof(recordCount));
+        coreIdx++;
+    }
+
+    coreIdx = 0;
+    while (coreIdx < traceCoreCount)
+    {
+        outputFile.write((const char *)loadedTraces[coreIdx].entries,
+                         loadedTraces[coreIdx].length * sizeof(PackedTraceEntry));
+        coreIdx++;
+    }
+
+    if (!outputFile.good())
+    {
+        cerr << "Error: Failed writing binary trace " << outputPath << endl;
+        return false;
+    }
+    return true;
+}
+
+void releaseTraces()
+{
+    int procIdx = 0;
+    while (procIdx < MAX_CORES)
+    {
+        installTraceSource(procIdx, nullptr);
+        loadedTraces[procIdx] = TraceView{nullptr, 0};
+        procIdx++;
+    }
+
+    if (mappedTraceBase != nullptr)
+    {
+        munmap(mappedTraceBase, mappedTraceSize);
+        mappedTraceBase = nullptr;
+        mappedTraceSize = 0;
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <string>
+#include <memory>
+#include "main.hpp"
+
+using namespace std;
+
+// Binary trace container layout (native byte order):
+//   TraceFileHeader
+//   unsigned long long recordCount[coreCount]
+//   PackedTraceEntry records, core 0 first, then core 1, ...
+const char TRACE_FILE_MAGIC[8] = {'L', '1', 'S', 'T', 'R', 'A', 'C', 'E'};
+const unsigned int TRACE_FILE_VERSION = 1;
+
+// Compressed traces share the header; see codec.hpp for the payload
+const char COMPRESSED_TRACE_MAGIC[8] = {'L', '1', 'S', 'T', 'R', 'C', 'Z', 'D'};
+const unsigned int COMPRESSED_TRACE_VERSION = 1;
+
+struct TraceFileHeader
+{
+    char magic[8];              // TRACE_FILE_MAGIC or COMPRESSED_TRACE_MAGIC
+    unsigned int version;       // Format version for that magic
+    unsigned int coreCount;     // Number of per-core record blocks
+};
+
+enum class TraceFileKind
+{
+    TEXT,           // <prefix>_procN.trace files
+    BINARY,         // Packed 64-bit records
+    COMPRESSED      // Delta/varint run-length encoded records
+};
+
+// Producer of successive trace windows for one core (streams, decoders)
+class TraceSource
+{
+public:
+    virtual ~TraceSource() {}
+
+    // Hand out the next window of entries; false at end of trace
+    virtual bool nextWindow(const PackedTraceEntry *&begin, const PackedTraceEntry *&end) = 0;
+
+    // Bits of the widest address the source can hand out
+    virtual int addressBits() const { return 63; }
+};
+
+// Sequential reader over one core's trace. For in-memory traces the window is
+// the whole trace; otherwise it is the current chunk produced by a source.
+struct TraceCursor
+{
+    const PackedTraceEntry *position;   // Current entry
+    const PackedTraceEntry *windowEnd;  // End of the current window
+    TraceSource *source;                // Null for in-memory traces
+
+    bool hasEntry() const { return position != windowEnd; }
+    PackedTraceEntry current() const { return *position; }
+
+    // Step to the next entry; returns false once the trace is exhausted
+    bool advance();
+};
+
+// Swap the cursor onto the source's next window; false at end of trace
+bool refillTraceWindow(TraceCursor &cursor);
+
+inline bool TraceCursor::advance()
+{
+    ++position;
+    return position != windowEnd || refillTraceWindow(*this);
+}
+
+// Traces loaded by the functions below for the command line: traceCoreCount
+// cores (-n), each an owned text trace in processorTraces or a mapped binary
+// trace viewed through loadedTraces, or a window source in loadedSources
+extern int traceCoreCount;
+extern vector<PackedTraceEntry> processorTraces[MAX_CORES];
+extern TraceView loadedTraces[MAX_CORES];
+extern TraceSource *loadedSources[MAX_CORES];
+
+// Parse one "R 0x817b08" style line; false for blank, comment or bad lines
+bool parseTraceLine(const string &line, PackedTraceEntry &entry);
+
+// Load <appPrefix>_procK.trace text files, K in [0, traceCoreCount), into processorTraces
+bool loadProcessorTraces(const string &appPrefix);
+
+// Open bounded-memory streams for all cores instead of loading the
+// traces; source is a text prefix or a binary trace file
+bool openTraceStreams(const string &source, size_t chunkEntries);
+
+// Decode traces held by window sources (compressed files) into
+// processorTraces so several simulations can read them concurrently
+void materializeTraces();
+
+// Cursor positioned at the first entry of a trace held in memory (source
+// null) or produced window by window by source
+TraceCursor openTraceCursor(const TraceView &view, TraceSource *source);
+
+// Bits needed to hold every address of a trace. Scans a trace held in
+// memory; a source is only read once, so it answers for itself.
+int traceAddressBits(const TraceView &view, const TraceSource *source);
+
+// Move a freshly opened cursor forward to entry index; false if the trace
+// has fewer entries
+bool seekTraceCursor(TraceCursor &cursor, unsigned long long index);
+
+// End a cursor's trace after its next entries entries. A cursor reading from
+// a source is redirected through limiter, which must outlive the cursor.
+void limitTraceCursor(TraceCursor &cursor, unsigned long long entries, unique_ptr<TraceSource> &limiter);
+
+// Lift that limit once the cursor has used up its entries, so it continues
+// where unlimited, the cursor as it was before the limit, would be
+void unlimitTraceCursor(TraceCursor &cursor, const TraceCursor &unlimited, unique_ptr<TraceSource> &limiter);
+
+// Take ownership of a core's window source; replaces any previous one
+void installTraceSource(int coreId, TraceSource *source);
+
+// Classify path by its magic; anything unrecognised is a text prefix
+TraceFileKind detectTraceFile(const string &path);
+
+// Map a trace file read-only; the mapping lives until releaseTraces()
+bool mapTraceFile(const string &path, const char *&base, size_t &size);
+
+// Map a binary trace file read-only and point loadedTraces into it
+bool mapBinaryTrace(const string &path);
+
+// Convert the traceCoreCount text traces of appPrefix into one binary trace file
+bool convertTextTraces(const string &appPrefix, const string &outputPath);
+
+// Unmap trace files and release all trace sources
+void releaseTraces();
+
+#endif // TRACE_HPP